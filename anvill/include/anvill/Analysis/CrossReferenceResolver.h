@@ -21,12 +21,14 @@
 #include <memory>
 
 namespace llvm {
+class Constant;
 class DataLayout;
 class Type;
 class Value;
 }  // namespace llvm
 namespace anvill {
 
+class CrossReferenceCacheImpl;
 class CrossReferenceResolverImpl;
 class EntityLifter;
 
@@ -99,6 +101,58 @@ struct ResolvedCrossReference {
   std::int64_t Displacement(const llvm::DataLayout &dl) const;
 };
 
+// Hit and miss statistics of a cross-reference cache.
+struct CrossReferenceCacheStatistics {
+  uint64_t num_hits{0};
+  uint64_t num_misses{0};
+
+  // Number of times that cached entries were dropped, either because the
+  // cached constant was destroyed, or because new entities may have made
+  // cached results stale.
+  uint64_t num_invalidations{0};
+
+  // Number of entries currently in the cache.
+  uint64_t num_entries{0};
+};
+
+// A thread-safe cache of resolved cross-references of `llvm::Constant`s. Every
+// `EntityLifter` owns one cache, which is shared by all of the resolvers
+// created from that lifter, so that constant expressions that appear across
+// many functions and passes are only resolved once per module.
+//
+// Entries are invalidated automatically when their constant is destroyed.
+class CrossReferenceCache {
+ public:
+  using Ptr = std::shared_ptr<CrossReferenceCache>;
+
+  static Ptr Create(void);
+
+  ~CrossReferenceCache(void);
+
+  // Drop the cached resolution of `val`, if any.
+  void Invalidate(llvm::Constant *val) const;
+
+  // Drop all cached resolutions.
+  void Clear(void) const;
+
+  // Returns `true` if there is a cached resolution of `val`.
+  bool Contains(llvm::Constant *val) const;
+
+  // Returns the current statistics of this cache.
+  CrossReferenceCacheStatistics Statistics(void) const;
+
+ private:
+  friend class CrossReferenceResolverImpl;
+
+  CrossReferenceCache(void);
+  CrossReferenceCache(const CrossReferenceCache &) = delete;
+  CrossReferenceCache(CrossReferenceCache &&) noexcept = delete;
+  CrossReferenceCache &operator=(const CrossReferenceCache &) = delete;
+  CrossReferenceCache &operator=(CrossReferenceCache &&) noexcept = delete;
+
+  std::unique_ptr<CrossReferenceCacheImpl> impl;
+};
+
 // Attempts to fold cross-references down into their intended addresses. This
 // class maintains an internal cache of prior resolved cross-references. An
 // internal cache of prior foldings is maintained, as the mechanism by which
@@ -112,14 +166,16 @@ class CrossReferenceResolver {
   ~CrossReferenceResolver(void);
 
   // The primary way of using a cross-reference resolver is with an entity
-  // lifter that can resolve global references on our behalf.
+  // lifter that can resolve global references on our behalf. Resolvers
+  // created this way share the lifter's cross-reference cache.
   explicit CrossReferenceResolver(const EntityLifter &lifter);
 
   // In the absence of an entity lifter, we need a DataLayout to determine
-  // offsets, etc.
+  // offsets, etc. Resolvers created this way have their own cache.
   explicit CrossReferenceResolver(const llvm::DataLayout &dl);
 
-  // Clear the internal cache.
+  // Clear the cache. If this resolver shares the cache of an entity lifter,
+  // then this affects all other resolvers created from that lifter.
   void ClearCache(void) const;
 
   // Try to resolve `val` as a cross-reference.
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2021 Trail of Bits, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <memory>
+
+namespace llvm {
+class DataLayout;
+class Value;
+}  // namespace llvm
+namespace anvill {
+
+class StackPointerResolverImpl;
+
+// Determines which values are derived from a symbolic stack pointer
+// representation, e.g. `__anvill_sp`. Answers are memoized, so that a single
+// resolver can be queried about every operand of every instruction in a
+// function while only visiting each value once, even though derivation chains
+// (e.g. of `getelementptr`s, `add`s, and casts) are shared between many
+// instructions.
+//
+// NOTE(pag): Memoized answers about instructions become stale when the
+//            function containing those instructions is modified, so a
+//            resolver should only live as long as a single analysis of a
+//            function, or be cleared after each modification.
+class StackPointerResolver {
+ public:
+  ~StackPointerResolver(void);
+
+  explicit StackPointerResolver(const llvm::DataLayout &dl);
+
+  // Returns `true` if it looks like `val` is derived from a symbolic stack
+  // pointer representation.
+  bool IsRelatedToStackPointer(llvm::Value *val) const;
+
+  // Forget all memoized answers, e.g. after the function being analyzed is
+  // modified.
+  void Clear(void);
+
+ private:
+  StackPointerResolver(void) = delete;
+  StackPointerResolver(const StackPointerResolver &) = delete;
+  StackPointerResolver(StackPointerResolver &&) noexcept = delete;
+  StackPointerResolver &operator=(const StackPointerResolver &) = delete;
+  StackPointerResolver &operator=(StackPointerResolver &&) noexcept = delete;
+
+  std::unique_ptr<StackPointerResolverImpl> impl;
+};
+
+}  // namespace anvill
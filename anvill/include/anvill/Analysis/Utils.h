@@ -34,6 +34,9 @@ bool IsReturnAddress(llvm::Value *val);
 
 // Returns `true` if it looks like `val` is derived from a symbolic stack
 // pointer representation.
+//
+// NOTE(pag): Nothing is memoized across calls. Prefer a `StackPointerResolver`
+//            when asking about many values of the same function.
 bool IsRelatedToStackPointer(const llvm::DataLayout &dl, llvm::Value *val);
 
 // Returns `true` if `val` looks like it is backed by a definition, and thus can
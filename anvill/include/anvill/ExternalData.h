@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2021 Trail of Bits, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+namespace llvm {
+class GlobalVariable;
+class raw_ostream;
+}  // namespace llvm
+namespace anvill {
+
+class ExternalDataImpl;
+
+// Collects the contents of variables that the data lifter leaves out of the
+// lifted module, e.g. very large tables, and instead leaves as external
+// declarations. The bytes of each variable are streamed into one blob as they
+// are added, and a manifest records where in the blob the bytes of each
+// variable are, so that downstream consumers can link or `incbin` them.
+class ExternalData {
+ public:
+  // The blob is written to `blob_os`, which must outlive this object.
+  explicit ExternalData(llvm::raw_ostream &blob_os);
+  ~ExternalData(void);
+
+  // Append `bytes`, the contents of `var`, which is located at `address`, to
+  // the blob. The blob is first padded with zeroes up to a multiple of
+  // `alignment`. Returns the offset of `bytes` in the blob.
+  uint64_t Add(llvm::GlobalVariable *var, uint64_t address,
+               std::string_view bytes, uint64_t alignment);
+
+  // Returns `true` if the contents of `var` are in the blob.
+  bool Contains(llvm::GlobalVariable *var) const;
+
+  // Returns the number of bytes written to the blob, including padding.
+  uint64_t Size(void) const;
+
+  // Print out the manifest as a JSON document. Variables are listed with the
+  // names that they have at the time of printing, as they may be renamed after
+  // being added. Variables that have since been deleted are omitted.
+  void PrintManifestJSON(llvm::raw_ostream &os) const;
+
+ private:
+  ExternalData(void) = delete;
+  ExternalData(const ExternalData &) = delete;
+  ExternalData(ExternalData &&) noexcept = delete;
+  ExternalData &operator=(const ExternalData &) = delete;
+  ExternalData &operator=(ExternalData &&) noexcept = delete;
+
+  std::unique_ptr<ExternalDataImpl> impl;
+};
+
+}  // namespace anvill
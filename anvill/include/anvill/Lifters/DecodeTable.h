@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2021 Trail of Bits, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace remill {
+class Arch;
+class Instruction;
+}  // namespace remill
+namespace anvill {
+
+class DecodeTableImpl;
+class MemoryProvider;
+
+// An immutable table of speculatively pre-decoded instructions. Decoding is
+// embarrassingly parallel, whereas lifting instructions into LLVM IR is
+// inherently serial. A decode table moves decoding into a separate, parallel
+// phase ahead of lifting, and the function lifter then consults the table
+// before decoding instructions itself.
+class DecodeTable {
+ public:
+  using ConstPtr = std::shared_ptr<const DecodeTable>;
+
+  ~DecodeTable(void);
+
+  // Decode all instructions reachable from the function entrypoints in
+  // `func_addresses`, following fall-throughs, direct branches, and direct
+  // calls. The entrypoints are partitioned across `num_threads` threads, each
+  // of which decodes into its own table, and the tables are then merged.
+  //
+  // NOTE(pag): Both `arch` and `memory` are used concurrently from several
+  //            threads when `num_threads > 1`, and so the architecture's
+  //            decoder and the memory provider must both be safe to use
+  //            concurrently. This is true of the x86 decoder and of the
+  //            `Program`-backed memory provider.
+  static ConstPtr Create(const remill::Arch *arch, MemoryProvider &memory,
+                         const std::vector<uint64_t> &func_addresses,
+                         unsigned num_threads);
+
+  // Return the pre-decoded, non-delayed instruction at `address`, or `nullptr`
+  // if we didn't decode an instruction at that address.
+  const remill::Instruction *Find(uint64_t address) const;
+
+  // Returns the number of pre-decoded instructions.
+  size_t Size(void) const;
+
+ private:
+  DecodeTable(void);
+  DecodeTable(const DecodeTable &) = delete;
+  DecodeTable(DecodeTable &&) noexcept = delete;
+  DecodeTable &operator=(const DecodeTable &) = delete;
+  DecodeTable &operator=(DecodeTable &&) noexcept = delete;
+
+  std::unique_ptr<DecodeTableImpl> impl;
+};
+
+}  // namespace anvill
@@ -18,8 +18,10 @@
 #pragma once
 
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <optional>
+#include <vector>
 
 namespace llvm {
 class Constant;
@@ -35,6 +37,7 @@ namespace anvill {
 struct FunctionDecl;
 struct GlobalVarDecl;
 
+class CrossReferenceCache;
 class EntityLifterImpl;
 class FunctionLifter;
 class LifterOptions;
@@ -54,19 +57,55 @@ class EntityLifter {
 
   explicit EntityLifter(
       const LifterOptions &options,
-      const std::shared_ptr<MemoryProvider> &mem_provider_,
+      const std::shared_ptr<::anvill::MemoryProvider> &mem_provider_,
       const std::shared_ptr<::anvill::TypeProvider> &type_provider_);
 
   // Assuming that `entity` is an entity that was lifted by this `EntityLifter`,
   // then return the address of that entity in the binary being lifted.
   std::optional<uint64_t> AddressOfEntity(llvm::Constant *entity) const;
 
+  // Applies `cb` to the address of each function that is directly called by
+  // the lifted function at `address`. These are the direct call edges that
+  // were discovered while decoding the function.
+  void ForEachDirectCallee(uint64_t address,
+                           std::function<void(uint64_t)> cb) const;
+
+  // Adds the entities lifted or declared since the last call to the
+  // `llvm.compiler.used` list, so that they aren't removed by global dead code
+  // elimination. Registration is batched because each addition to
+  // `llvm.compiler.used` rebuilds the whole list. `OptimizeModule` and
+  // `LiftReachableEntities` call this; other users of the entity lifter
+  // should call it once they're done lifting a batch of entities.
+  void MaterializeCompilerUsed(void) const;
+
+  // When `LifterOptions::lazy_data_initializers` is enabled, lifted variables
+  // are declared without initializers. This reads and lifts the initializers
+  // of those variables, in address order. If `only_referenced` is `true`, then
+  // only variables that are still referenced by something other than
+  // `llvm.used` or `llvm.compiler.used` are initialized. Variables declared
+  // while lifting initializers are handled too. Returns the number of
+  // initialized variables.
+  unsigned MaterializeDataInitializers(bool only_referenced = true) const;
+
+  // Initialize the lifted variable `var` if it was declared without an
+  // initializer, e.g. because `LifterOptions::lazy_data_initializers` is
+  // enabled. Returns `true` if `var` was initialized.
+  bool MaterializeDataInitializer(llvm::Constant *var) const;
+
   // Return the options being used by this entity lifter.
   const LifterOptions &Options(void) const;
 
+  // Return a reference to the memory provider for this entity lifter.
+  MemoryProvider &MemoryProvider(void) const;
+
   // Return a reference to the type provider for this entity lifter.
   TypeProvider &TypeProvider(void) const;
 
+  // Return the module-scoped cache of resolved cross-references, which is
+  // shared by all cross-reference resolvers created from this entity lifter.
+  const std::shared_ptr<::anvill::CrossReferenceCache> &
+  CrossReferenceCache(void) const;
+
   // Lift a function and return it. Returns `nullptr` if there was a failure.
   llvm::Function *LiftEntity(const FunctionDecl &decl) const;
 
@@ -79,6 +118,14 @@ class EntityLifter {
   // Lift a variable and return it. Returns `nullptr` if there was a failure.
   llvm::Constant *DeclareEntity(const GlobalVarDecl &decl) const;
 
+  // Demand-driven lifting. Lift the functions and variables at each of the
+  // addresses in `roots`, then transitively lift the functions and variables
+  // that they reference, e.g. direct callees, or data referenced by constant
+  // addresses in lifted code. Entities that aren't reachable from `roots` are
+  // at most declared. Type information for the roots and anything discovered
+  // comes from the type provider. Returns the number of lifted entities.
+  unsigned LiftReachableEntities(const std::vector<uint64_t> &roots) const;
+
   EntityLifter(const EntityLifter &) = default;
   EntityLifter(EntityLifter &&) noexcept = default;
   EntityLifter &operator=(const EntityLifter &) = default;
@@ -19,6 +19,7 @@
 
 #include <cstddef>
 
+#include <anvill/Lifters/DecodeTable.h>
 #include <anvill/Providers/IControlFlowProvider.h>
 
 namespace llvm {
@@ -29,6 +30,9 @@ class Arch;
 }  // namespace remill
 namespace anvill {
 
+class ExternalData;
+class Statistics;
+
 enum class StateStructureInitializationProcedure : char {
 
   // Don't do anything with the `alloca State`.
@@ -77,10 +81,42 @@ enum class StackFrameStructureInitializationProcedure : char {
   // Use symbolic values to initialize each byte in the stack frame. This
   // is useful to track how the stack frame is used and also allows us to
   // generate bitcode that can be compiled while also communicating the
-  // missing/unmodeled input dependencies
+  // missing/unmodeled input dependencies. The symbolic values are copied
+  // out of shared `__anvill_stack_window_*` byte arrays, each covering
+  // a fixed-size window of stack offsets.
   kSymbolic,
 };
 
+// What the function lifter should do when lifting a function exceeds one of
+// the lifting budgets in `LifterOptions`.
+enum class LiftingBudgetExceededAction : char {
+
+  // Leave the function as a declaration, i.e. discard anything lifted so far.
+  kDeclareOnly,
+
+  // Keep what has been lifted so far, and terminate every control-flow path
+  // that leads to not-yet-lifted code with a call to `__remill_error`. If the
+  // IR instruction budget is exceeded, then there is no sensible cut-off
+  // point, and the function is left as a declaration.
+  kCallRemillError,
+};
+
+// How many optimization passes to run, and how often. See
+// `docs/OptimizationProfiles.md` for details.
+enum class OptimizationProfile : char {
+
+  // Skips global value numbering, splitting stack frames at the return
+  // address, and pointer brightening.
+  kFast,
+
+  // The default pipeline.
+  kBalanced,
+
+  // Iterates the cleanup, entity recovery, and stack recovery phases until
+  // they stop changing anything, or until an iteration limit is reached.
+  kThorough,
+};
+
 // Options that direct the behavior of the code and data lifters.
 class LifterOptions {
  public:
@@ -96,11 +132,30 @@ class LifterOptions {
             StackFrameStructureInitializationProcedure::kSymbolic),
         stack_frame_lower_padding(0U),
         stack_frame_higher_padding(0U),
+        max_decoded_instructions(0U),
+        max_basic_blocks(0U),
+        max_ir_instructions(0U),
+        lifting_budget_exceeded_action(
+            LiftingBudgetExceededAction::kCallRemillError),
+        optimization_profile(OptimizationProfile::kBalanced),
+        num_optimization_threads(1U),
+        max_pass_group_iterations(4U),
+        statistics(nullptr),
+        external_data_threshold(0U),
+        external_data(nullptr),
         symbolic_program_counter(true),
         symbolic_stack_pointer(true),
         symbolic_return_address(true),
         symbolic_register_types(true),
-        store_inferred_register_values(true) {
+        store_inferred_register_values(true),
+        enable_inlining_phase(true),
+        enable_cleanup_phase(true),
+        enable_entity_recovery_phase(true),
+        enable_stack_recovery_phase(true),
+        enable_remill_control_flow_phase(true),
+        capture_function_snapshots(false),
+        partition_stack_frames(true),
+        lazy_data_initializers(false) {
     CheckModuleContextMatchesArch();
   }
 
@@ -113,6 +168,11 @@ class LifterOptions {
   // The control flow provider, used for thunk redirections
   IControlFlowProvider::Ptr ctrl_flow_provider;
 
+  // An optional table of pre-decoded instructions. If present, then the
+  // function lifter will look for instructions in this table before trying
+  // to decode them itself.
+  DecodeTable::ConstPtr decode_table;
+
   // The function lifter produces functions with Remill's state structure
   // allocated on the stack. This configuration option determines how the
   // state structure is initialized.
@@ -134,6 +194,57 @@ class LifterOptions {
   // How many bytes of padding should be added before recovered stack frames
   std::size_t stack_frame_higher_padding;
 
+  //
+  // Lifting budgets bound the worst-case cost of lifting any one function,
+  // e.g. obfuscated code with enormous basic blocks, or data that is
+  // mistakenly decoded as millions of instructions. A value of zero means
+  // that there is no limit.
+  //
+
+  // Maximum number of instructions to decode in any one function.
+  unsigned max_decoded_instructions;
+
+  // Maximum number of basic blocks, i.e. control-flow edges to instructions,
+  // to lift in any one function.
+  unsigned max_basic_blocks;
+
+  // Maximum number of LLVM instructions in any one function after all
+  // instruction semantics have been inlined into it.
+  unsigned max_ir_instructions;
+
+  // What to do when one of the above budgets is exceeded.
+  LiftingBudgetExceededAction lifting_budget_exceeded_action;
+
+  // How much effort should `OptimizeModule` put into optimizing lifted code?
+  OptimizationProfile optimization_profile;
+
+  // How many threads should `OptimizeModule` use for its per-function passes?
+  // If this is greater than one, then the passes that don't depend on the
+  // entity lifter run on copies of the lifted functions, in separate LLVM
+  // contexts, on this many threads. Passes that depend on the entity lifter,
+  // e.g. to recover uses of functions and variables, still run serially.
+  unsigned num_optimization_threads;
+
+  // Maximum number of rounds for which `OptimizeModule` iterates groups of
+  // passes that feed into each other, e.g. entity recovery and instruction
+  // folding, over a function. A value of one runs each pass once.
+  unsigned max_pass_group_iterations;
+
+  // An optional sink for timing and IR size statistics. If present, then the
+  // function lifter records statistics about each lifted function, and
+  // `OptimizeModule` records statistics about each pass run over each
+  // function. Not owned by the options.
+  Statistics *statistics;
+
+  // Variables that are at least `external_data_threshold` bytes in size, and
+  // that contain no pointers, are left as declarations, and their contents
+  // are added to `external_data` instead of being lifted into initializers.
+  // This keeps bulk data, e.g. large `.rodata` tables, out of the module. A
+  // threshold of zero, or a null `external_data`, disables this. Not owned by
+  // the options.
+  uint64_t external_data_threshold;
+  ExternalData *external_data;
+
   // Should the program counter in lifted functions be represented with a
   // symbolic expression? If so, then it takes on the form:
   //
@@ -196,6 +307,51 @@ class LifterOptions {
   // forwarding.
   bool store_inferred_register_values : 1;
 
+  //
+  // The optimization pipeline in `OptimizeModule` is a sequence of named
+  // phases, run in the order below. Each phase has its own pass manager,
+  // and runs over all functions before the next phase begins.
+  //
+
+  // Inline lifted functions into each other, then remove unused globals.
+  bool enable_inlining_phase : 1;
+
+  // Generic scalar cleanup (GVN, SCCP, SROA, InstCombine, etc.), and lowering
+  // of memory access, type hint, and compiler barrier intrinsics.
+  bool enable_cleanup_phase : 1;
+
+  // Recover uses of lifted functions and variables from integer constants
+  // and `__anvill_pc`-relative expressions.
+  bool enable_entity_recovery_phase : 1;
+
+  // Recover stack frames, split them at the return address, and brighten
+  // integer operations into pointer operations.
+  bool enable_stack_recovery_phase : 1;
+
+  // Lower Remill's jump, function return, and undefined value intrinsics.
+  bool enable_remill_control_flow_phase : 1;
+
+  // Should anvill's function passes print out the IR of each function before
+  // transforming it? If so, then fatal optimization errors report the IR from
+  // both before and after the failing pass; otherwise only the IR from after
+  // the pass is reported. This is expensive, and meant for debugging.
+  bool capture_function_snapshots : 1;
+
+  // Should the RecoverStackFrameInformation function pass partition recovered
+  // stack frames into independently allocated slots, based on how the frame
+  // is accessed? Slots are easier for SROA and mem2reg to promote than one
+  // big byte array. Frames whose addresses escape, e.g. into a call, are left
+  // unpartitioned.
+  bool partition_stack_frames : 1;
+
+  // Should the data lifter declare lifted variables without initializers, and
+  // defer reading and lifting their initializers until they're requested via
+  // `EntityLifter::MaterializeDataInitializers`? `OptimizeModule` requests
+  // the initializers of those variables that are still referenced after
+  // optimization. Entities referenced only by the initializers of variables
+  // are discovered late, and so are at most declared.
+  bool lazy_data_initializers : 1;
+
  private:
   LifterOptions(void) = delete;
 
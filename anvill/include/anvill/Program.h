@@ -23,6 +23,7 @@
 #include <functional>
 #include <memory>
 #include <string_view>
+#include <vector>
 
 // Forward declare
 namespace llvm {
@@ -227,6 +228,16 @@ class Program {
   void
   ForEachFunction(std::function<bool(const FunctionDecl *)> callback) const;
 
+  // Iterate over all functions in callee-first order, i.e. such that the
+  // direct callees of a function are visited before the function itself.
+  // `get_callees` is asked to fill in the addresses of the direct callees
+  // of each function, e.g. as discovered while lifting. Mutually recursive
+  // functions (strongly connected components of the call graph) are visited
+  // consecutively, in order of address.
+  void ForEachFunctionInCalleeFirstOrder(
+      std::function<void(uint64_t, std::vector<uint64_t> &)> get_callees,
+      std::function<bool(const FunctionDecl *)> callback) const;
+
   // Search for a specific function by its address.
   const FunctionDecl *FindFunction(uint64_t address) const;
 
@@ -20,6 +20,8 @@
 #include <cstdint>
 #include <memory>
 #include <tuple>
+#include <utility>
+#include <vector>
 
 namespace anvill {
 
@@ -75,6 +77,20 @@ class MemoryProvider {
   virtual std::tuple<uint8_t, ByteAvailability, BytePermission>
   Query(uint64_t address) = 0;
 
+  // Read up to `size` contiguous bytes starting at `address` into `bytes`,
+  // stopping early at the first byte that isn't available, or whose
+  // permissions differ from those of the first byte. Returns the number of
+  // bytes read. The default implementation calls `Query` once per byte;
+  // providers with contiguous backing memory should override it.
+  virtual uint64_t ReadBytes(uint64_t address, uint64_t size,
+                             std::vector<uint8_t> &bytes);
+
+  // Returns the range of addresses, `[begin, end)`, of the contiguous memory
+  // containing `address`, or an empty range if `address` is not valid. The
+  // default implementation calls `Query` once, and so only reports `address`
+  // itself; providers that index their memory by range should override it.
+  virtual std::pair<uint64_t, uint64_t> RangeContaining(uint64_t address);
+
   // Sources bytes from an `anvill::Program`.
   static std::shared_ptr<MemoryProvider>
   CreateProgramMemoryProvider(const Program &program);
@@ -25,6 +25,7 @@
 #include <optional>
 #include <string>
 #include <utility>
+#include <vector>
 
 namespace llvm {
 class FunctionType;
@@ -35,6 +36,10 @@ namespace anvill {
 
 class Program;
 
+// A list of `(instruction address, typed register)` pairs for all register
+// hints in a function, sorted by instruction address.
+using TypedRegisterHints = std::vector<std::pair<uint64_t, TypedRegisterDecl>>;
+
 // Provides bytes of memory from some source.
 class TypeProvider {
  public:
@@ -57,6 +62,14 @@ class TypeProvider {
                          std::optional<uint64_t>)>
           typed_reg_cb);
 
+  // Try to get the types of all hinted registers in the function beginning at
+  // `func_address`, and add them to `hints`, sorted by instruction address.
+  // This lets a lifter query the hints once per function instead of once per
+  // instruction. Returns `false` if this provider doesn't support bulk
+  // queries, in which case `QueryRegisterStateAtInstruction` should be used.
+  virtual bool QueryRegisterStatesInFunction(uint64_t func_address,
+                                             TypedRegisterHints &hints);
+
   // Sources types from an `anvill::Program`.
   static std::shared_ptr<TypeProvider>
   CreateProgramTypeProvider(llvm::LLVMContext &context_,
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2021 Trail of Bits, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <remill/BC/Compat/Error.h>
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace llvm {
+class Module;
+}  // namespace llvm
+namespace anvill {
+
+// Selects which of the functions of a program are lifted into one shard, by
+// splitting the sorted function addresses into `num_shards` contiguous runs
+// of (nearly) equal length, and/or by address ranges.
+struct FunctionSelector {
+  unsigned shard_index{0};
+  unsigned num_shards{1};
+
+  // Address ranges, `[begin, end)`. If non-empty, only functions in one of
+  // these ranges are selected.
+  std::vector<std::pair<uint64_t, uint64_t>> ranges;
+
+  // Sorted, unique addresses of all functions in the program.
+  std::vector<uint64_t> func_addresses;
+
+  inline bool IsEnabled(void) const {
+    return 1u < num_shards || !ranges.empty();
+  }
+
+  // Returns `true` if the function at `address` should be lifted.
+  bool Selects(uint64_t address) const;
+};
+
+class ShardLinkerImpl;
+
+// Links shards, i.e. modules that were lifted separately from different
+// functions of the same program, into one destination module.
+//
+// Lifted entities (`sub_*`, `var_*`, `data_*`) are unified by their kinds and
+// addresses, and only the first definition of each is kept. Entities that
+// are named after symbols, rather than by their addresses, are unified by
+// name only. Mutable variables with local linkage, e.g. `__anvill_pc`, are
+// unified by name (or address), so that every shard shares the same state.
+// Local constants and functions are copied as-is, as their copies are
+// interchangeable.
+class ShardLinker {
+ public:
+  // Shards are linked into `dest`, which must outlive this object.
+  explicit ShardLinker(llvm::Module &dest);
+  ~ShardLinker(void);
+
+  // Link `src` into the destination module. Returns an error if a local
+  // variable of `src` can't be unified with the destination module, e.g.
+  // because it is unnamed, or because it has a different type than the
+  // variable of the same name in the destination module.
+  llvm::Error Link(std::unique_ptr<llvm::Module> src);
+
+  // Restore the local linkage of the variables that were unified while
+  // linking. This must be called once, after the last shard is linked.
+  void Finish(void);
+
+ private:
+  ShardLinker(void) = delete;
+  ShardLinker(const ShardLinker &) = delete;
+  ShardLinker(ShardLinker &&) noexcept = delete;
+  ShardLinker &operator=(const ShardLinker &) = delete;
+  ShardLinker &operator=(ShardLinker &&) noexcept = delete;
+
+  std::unique_ptr<ShardLinkerImpl> impl;
+};
+
+}  // namespace anvill
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2021 Trail of Bits, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace llvm {
+class Function;
+class Module;
+class raw_ostream;
+}  // namespace llvm
+namespace anvill {
+
+class StatisticsImpl;
+
+// The size of a function, or of a module, in LLVM IR.
+struct IRSize {
+  unsigned num_instructions{0};
+  unsigned num_basic_blocks{0};
+
+  static IRSize Of(const llvm::Function &func);
+  static IRSize Of(const llvm::Module &module);
+};
+
+// Statistics about one run of one pass over one function. Module passes are
+// recorded with an empty `function_name`, and with sizes of the whole module.
+struct PassRunStatistics {
+  std::string phase_name;
+  std::string pass_name;
+  std::string function_name;
+  uint64_t wall_time_us{0};
+  IRSize before;
+  IRSize after;
+};
+
+// Statistics about the lifting of one function.
+struct FunctionLiftStatistics {
+  uint64_t address{0};
+  std::string function_name;
+  uint64_t wall_time_us{0};
+  unsigned num_decoded_instructions{0};
+  IRSize size;
+};
+
+// Collects timing and IR size statistics from the lifters and from
+// `OptimizeModule`, so that we can see where time goes, and catch performance
+// regressions. Recording is thread-safe, as the optimizer may record from
+// several threads at once.
+class Statistics {
+ public:
+  Statistics(void);
+  ~Statistics(void);
+
+  // Record one run of a pass over a function or module.
+  void RecordPassRun(PassRunStatistics stats);
+
+  // Record the lifting of one function.
+  void RecordFunctionLift(FunctionLiftStatistics stats);
+
+  // Record the value of a named counter, e.g. the number of cache hits.
+  // Recording the same counter again replaces its value.
+  void RecordCounter(const std::string &name, uint64_t value);
+
+  // Print out the statistics as a JSON document. In addition to the raw
+  // per-pass and per-function records, the document contains a per-pass
+  // summary, aggregated over all functions.
+  void PrintJSON(llvm::raw_ostream &os) const;
+
+ private:
+  Statistics(const Statistics &) = delete;
+  Statistics(Statistics &&) noexcept = delete;
+  Statistics &operator=(const Statistics &) = delete;
+  Statistics &operator=(Statistics &&) noexcept = delete;
+
+  std::unique_ptr<StatisticsImpl> impl;
+};
+
+}  // namespace anvill
@@ -21,15 +21,23 @@
 #include <anvill/Lifters/EntityLifter.h>
 #include <anvill/Lifters/Options.h>
 
+#include <llvm/ADT/SmallVector.h>
 #include <llvm/IR/Constant.h>
 #include <llvm/IR/Constants.h>
 #include <llvm/IR/DataLayout.h>
 #include <llvm/IR/Instruction.h>
 #include <llvm/IR/Instructions.h>
 #include <llvm/IR/Module.h>
+#include <llvm/IR/ValueHandle.h>
 #include <remill/BC/Util.h>
 
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 namespace anvill {
 namespace {
@@ -60,22 +68,123 @@ static int64_t Signed(uint64_t val, uint64_t size) {
 
 }  // namespace
 
+class CrossReferenceCacheImpl {
+ public:
+  // Drops the cache entry of a constant when that constant is destroyed.
+  class InvalidationHandle final : public llvm::CallbackVH {
+   public:
+    InvalidationHandle(llvm::Constant *val_, CrossReferenceCacheImpl *cache_)
+        : llvm::CallbackVH(val_),
+          val(val_),
+          cache(cache_) {}
+
+    // NOTE(pag): This destroys `this`.
+    void deleted(void) final {
+      cache->Erase(val);
+    }
+
+   private:
+    llvm::Constant *const val;
+    CrossReferenceCacheImpl *const cache;
+  };
+
+  struct Entry {
+    ResolvedCrossReference xr;
+    std::unique_ptr<InvalidationHandle> handle;
+  };
+
+  // Look up a cached resolution of `val`, and count the hit or miss.
+  bool Find(llvm::Constant *val, ResolvedCrossReference &xr);
+
+  // Cache `xr` as the resolution of `val`.
+  void Insert(llvm::Constant *val, const ResolvedCrossReference &xr);
+
+  // Drop the cached resolution of `val`, if any.
+  void Erase(llvm::Constant *val);
+
+  // Drop all cached resolutions.
+  void Clear(void);
+
+  mutable std::shared_mutex lock;
+  std::unordered_map<llvm::Constant *, Entry> entries;
+
+  std::atomic<uint64_t> num_hits{0};
+  std::atomic<uint64_t> num_misses{0};
+  std::atomic<uint64_t> num_invalidations{0};
+};
+
+bool CrossReferenceCacheImpl::Find(llvm::Constant *val,
+                                   ResolvedCrossReference &xr) {
+  std::shared_lock<std::shared_mutex> locker(lock);
+  if (auto it = entries.find(val); it != entries.end()) {
+    xr = it->second.xr;
+    num_hits.fetch_add(1u, std::memory_order_relaxed);
+    return true;
+  } else {
+    num_misses.fetch_add(1u, std::memory_order_relaxed);
+    return false;
+  }
+}
+
+void CrossReferenceCacheImpl::Insert(llvm::Constant *val,
+                                     const ResolvedCrossReference &xr) {
+  std::unique_lock<std::shared_mutex> locker(lock);
+  auto &entry = entries[val];
+  entry.xr = xr;
+  if (!entry.handle) {
+    entry.handle.reset(new InvalidationHandle(val, this));
+  }
+}
+
+void CrossReferenceCacheImpl::Erase(llvm::Constant *val) {
+  std::unique_lock<std::shared_mutex> locker(lock);
+  if (entries.erase(val)) {
+    num_invalidations.fetch_add(1u, std::memory_order_relaxed);
+  }
+}
+
+void CrossReferenceCacheImpl::Clear(void) {
+  std::unique_lock<std::shared_mutex> locker(lock);
+  num_invalidations.fetch_add(entries.size(), std::memory_order_relaxed);
+  entries.clear();
+}
+
 class CrossReferenceResolverImpl {
  public:
   CrossReferenceResolverImpl(const llvm::DataLayout &dl_,
                              AddressResolverFuncType address_of_entity_,
-                             EntityResolverFuncType entity_at_address_)
+                             EntityResolverFuncType entity_at_address_,
+                             CrossReferenceCache::Ptr cache_)
       : dl(dl_),
         address_of_entity(address_of_entity_),
-        entity_at_address(entity_at_address_) {}
-
-  ResolvedCrossReference ResolveInstruction(llvm::Instruction *inst_val);
-  ResolvedCrossReference ResolveConstant(llvm::Constant *const_val);
+        entity_at_address(entity_at_address_),
+        cache(std::move(cache_)),
+        xref_cache(*(cache->impl)) {}
+
+  // Resolutions of the values visited while resolving one value.
+  using ResolutionMap =
+      std::unordered_map<llvm::Value *, ResolvedCrossReference>;
+
+  // Evaluate one value, assuming that the values that it depends upon, as
+  // determined by `CollectDependencies`, are already in `results`.
+  ResolvedCrossReference EvaluateInstruction(llvm::Instruction *inst_val,
+                                             const ResolutionMap &results);
+  ResolvedCrossReference EvaluateConstant(llvm::Constant *const_val,
+                                          const ResolutionMap &results);
+  ResolvedCrossReference EvaluateConstantExpr(llvm::ConstantExpr *const_val,
+                                              const ResolutionMap &results);
+  ResolvedCrossReference EvaluateCall(llvm::CallInst *val,
+                                      const ResolutionMap &results);
   ResolvedCrossReference ResolveGlobalValue(llvm::GlobalValue *const_val);
-  ResolvedCrossReference ResolveConstantExpr(llvm::ConstantExpr *const_val);
 
-  // Try to resolve `val` as a cross-reference.
-  ResolvedCrossReference ResolveCall(llvm::CallInst *val);
+  // Returns the resolution of `val` in `results`.
+  static ResolvedCrossReference Lookup(const ResolutionMap &results,
+                                       llvm::Value *val);
+
+  // Collect the operands of `val` whose resolutions are needed to evaluate
+  // `val`.
+  void CollectDependencies(llvm::Value *val,
+                           llvm::SmallVectorImpl<llvm::Value *> &deps);
 
   // Try to resolve `val` as a cross-reference.
   ResolvedCrossReference ResolveValue(llvm::Value *val);
@@ -176,8 +285,9 @@ class CrossReferenceResolverImpl {
   // with addresses.
   const EntityResolverFuncType entity_at_address;
 
-  // Cache of resolved values.
-  std::unordered_map<llvm::Value *, ResolvedCrossReference> xref_cache;
+  // Cache of resolved constants. This may be shared with other resolvers.
+  const CrossReferenceCache::Ptr cache;
+  CrossReferenceCacheImpl &xref_cache;
 };
 
 
@@ -247,8 +357,12 @@ ResolvedCrossReference CrossReferenceResolverImpl::MergeLeft(
   return xr;
 }
 
-ResolvedCrossReference
-CrossReferenceResolverImpl::ResolveInstruction(llvm::Instruction *inst_val) {
+// Evaluate an instruction, given the resolutions of its operands.
+ResolvedCrossReference CrossReferenceResolverImpl::EvaluateInstruction(
+    llvm::Instruction *inst_val, const ResolutionMap &results) {
+  const auto get = [&results](llvm::Value *val) {
+    return Lookup(results, val);
+  };
 
   const uint64_t size =
       inst_val->getOperand(0)->getType()->getPrimitiveSizeInBits();
@@ -259,8 +373,8 @@ CrossReferenceResolverImpl::ResolveInstruction(llvm::Instruction *inst_val) {
   switch (inst_val->getOpcode()) {
 #define FOLD_CASE(name) \
   case llvm::Instruction::name: \
-    return Fold##name(ResolveValue(inst_val->getOperand(0)), \
-                      ResolveValue(inst_val->getOperand(1)), mask, size);
+    return Fold##name(get(inst_val->getOperand(0)), \
+                      get(inst_val->getOperand(1)), mask, size);
 
     FOLD_CASE(Add)
     FOLD_CASE(Sub)
@@ -279,26 +393,26 @@ CrossReferenceResolverImpl::ResolveInstruction(llvm::Instruction *inst_val) {
 #undef FOLD_CASE
 
     case llvm::Instruction::ZExt: {
-      auto xr = ResolveValue(inst_val->getOperand(0));
+      auto xr = get(inst_val->getOperand(0));
       xr.u.address &= mask;
       return xr;
     }
 
     case llvm::Instruction::SExt: {
-      auto xr = ResolveValue(inst_val->getOperand(0));
+      auto xr = get(inst_val->getOperand(0));
       xr.u.displacement = Signed(xr.u.address, size);
       xr.u.address &= out_mask;
       return xr;
     }
 
     case llvm::Instruction::Trunc: {
-      auto xr = ResolveValue(inst_val->getOperand(0));
+      auto xr = get(inst_val->getOperand(0));
       xr.u.address &= out_mask;
       return xr;
     }
 
     case llvm::Instruction::IntToPtr: {
-      auto xr = ResolveValue(inst_val->getOperand(0));
+      auto xr = get(inst_val->getOperand(0));
       if (auto ptr_type = llvm::cast<llvm::PointerType>(inst_val->getType());
           !xr.displacement_from_hinted_value_type) {
         xr.hinted_value_type = ptr_type->getElementType();
@@ -307,10 +421,10 @@ CrossReferenceResolverImpl::ResolveInstruction(llvm::Instruction *inst_val) {
     }
 
     case llvm::Instruction::PtrToInt:
-      return ResolveValue(inst_val->getOperand(0));
+      return get(inst_val->getOperand(0));
 
     case llvm::Instruction::BitCast: {
-      auto xr = ResolveValue(inst_val->getOperand(0));
+      auto xr = get(inst_val->getOperand(0));
       if (auto ptr_type =
               llvm::dyn_cast<llvm::PointerType>(inst_val->getType());
           ptr_type && !xr.displacement_from_hinted_value_type) {
@@ -320,28 +434,23 @@ CrossReferenceResolverImpl::ResolveInstruction(llvm::Instruction *inst_val) {
     }
 
     case llvm::Instruction::Call:
-      return ResolveCall(llvm::dyn_cast<llvm::CallInst>(inst_val));
+      return EvaluateCall(llvm::dyn_cast<llvm::CallInst>(inst_val), results);
 
     default: return {};
   }
 }
 
-// Try to resolve a constant to a cross-reference.
-ResolvedCrossReference
-CrossReferenceResolverImpl::ResolveConstant(llvm::Constant *const_val) {
+// Evaluate a constant, given the resolutions of its operands.
+ResolvedCrossReference CrossReferenceResolverImpl::EvaluateConstant(
+    llvm::Constant *const_val, const ResolutionMap &results) {
 
-  auto it = xref_cache.find(const_val);
-  if (it != xref_cache.end()) {
-    return it->second;
-  }
-
-  auto &xr = xref_cache[const_val];
+  ResolvedCrossReference xr = {};
 
   if (auto gv = llvm::dyn_cast<llvm::GlobalValue>(const_val)) {
     xr = ResolveGlobalValue(gv);
 
   } else if (auto ce = llvm::dyn_cast<llvm::ConstantExpr>(const_val)) {
-    xr = ResolveConstantExpr(ce);
+    xr = EvaluateConstantExpr(ce, results);
 
   } else if (auto ci = llvm::dyn_cast<llvm::ConstantInt>(const_val)) {
     xr.u.address = ci->getZExtValue();
@@ -403,8 +512,12 @@ CrossReferenceResolverImpl::ResolveGlobalValue(llvm::GlobalValue *gv) {
   return xr;
 }
 
-ResolvedCrossReference
-CrossReferenceResolverImpl::ResolveConstantExpr(llvm::ConstantExpr *ce) {
+// Evaluate a constant expression, given the resolutions of its operands.
+ResolvedCrossReference CrossReferenceResolverImpl::EvaluateConstantExpr(
+    llvm::ConstantExpr *ce, const ResolutionMap &results) {
+  const auto get = [&results](llvm::Value *val) {
+    return Lookup(results, val);
+  };
 
   if (auto maybe_addr = address_of_entity(ce); maybe_addr) {
     ResolvedCrossReference xr;
@@ -428,8 +541,8 @@ CrossReferenceResolverImpl::ResolveConstantExpr(llvm::ConstantExpr *ce) {
 
 #define FOLD_CASE(name) \
   case llvm::Instruction::name: \
-    return Fold##name(ResolveConstant(ce->getOperand(0)), \
-                      ResolveConstant(ce->getOperand(1)), mask, size);
+    return Fold##name(get(ce->getOperand(0)), \
+                      get(ce->getOperand(1)), mask, size);
 
       FOLD_CASE(Add)
       FOLD_CASE(Sub)
@@ -448,26 +561,26 @@ CrossReferenceResolverImpl::ResolveConstantExpr(llvm::ConstantExpr *ce) {
 #undef FOLD_CASE
 
     case llvm::Instruction::ZExt: {
-      auto xr = ResolveConstant(ce->getOperand(0));
+      auto xr = get(ce->getOperand(0));
       xr.u.address &= mask;
       return xr;
     }
 
     case llvm::Instruction::SExt: {
-      auto xr = ResolveConstant(ce->getOperand(0));
+      auto xr = get(ce->getOperand(0));
       xr.u.displacement = Signed(xr.u.address, size);
       xr.u.address &= out_mask;
       return xr;
     }
 
     case llvm::Instruction::Trunc: {
-      auto xr = ResolveConstant(ce->getOperand(0));
+      auto xr = get(ce->getOperand(0));
       xr.u.address &= out_mask;
       return xr;
     }
 
     case llvm::Instruction::IntToPtr: {
-      auto xr = ResolveConstant(ce->getOperand(0));
+      auto xr = get(ce->getOperand(0));
       if (auto ptr_type = llvm::cast<llvm::PointerType>(ce->getType());
           !xr.displacement_from_hinted_value_type) {
         xr.hinted_value_type = ptr_type->getElementType();
@@ -475,10 +588,10 @@ CrossReferenceResolverImpl::ResolveConstantExpr(llvm::ConstantExpr *ce) {
       return xr;
     }
 
-    case llvm::Instruction::PtrToInt: return ResolveConstant(ce->getOperand(0));
+    case llvm::Instruction::PtrToInt: return get(ce->getOperand(0));
 
     case llvm::Instruction::BitCast: {
-      auto xr = ResolveConstant(ce->getOperand(0));
+      auto xr = get(ce->getOperand(0));
       if (auto ptr_type = llvm::dyn_cast<llvm::PointerType>(ce->getType());
           ptr_type && !xr.displacement_from_hinted_value_type) {
         xr.hinted_value_type = ptr_type->getElementType();
@@ -487,18 +600,18 @@ CrossReferenceResolverImpl::ResolveConstantExpr(llvm::ConstantExpr *ce) {
     }
 
     case llvm::Instruction::ICmp: {
-      return FoldICmp(ResolveConstant(ce->getOperand(0)),
-                      ResolveConstant(ce->getOperand(1)), mask, size,
+      return FoldICmp(get(ce->getOperand(0)),
+                      get(ce->getOperand(1)), mask, size,
                       ce->getPredicate());
     }
 
     case llvm::Instruction::GetElementPtr: {
-      auto base = ResolveConstant(ce->getOperand(0));
+      auto base = get(ce->getOperand(0));
 
       // In the event that an index is non-constant, we'll try to also resolve
       // it using our value resolver.
-      auto visit = [=](llvm::Value &val, llvm::APInt &ap) -> bool {
-        if (const auto index_xr = ResolveValue(&val); index_xr.is_valid) {
+      auto visit = [=, &get](llvm::Value &val, llvm::APInt &ap) -> bool {
+        if (const auto index_xr = get(&val); index_xr.is_valid) {
           ap += static_cast<uint64_t>(Signed(index_xr.u.address, ptr_size));
           return true;
         } else {
@@ -523,12 +636,12 @@ CrossReferenceResolverImpl::ResolveConstantExpr(llvm::ConstantExpr *ce) {
     // TODO(pag): What happens if there's a `trunc` on a pointer and that is
     //            the condition?
     case llvm::Instruction::Select: {
-      auto cond = ResolveConstant(ce->getOperand(0));
+      auto cond = get(ce->getOperand(0));
       ResolvedCrossReference selected_val = {};
       if (cond.u.address) {
-        selected_val = ResolveConstant(ce->getOperand(1));
+        selected_val = get(ce->getOperand(1));
       } else {
-        selected_val = ResolveConstant(ce->getOperand(2));
+        selected_val = get(ce->getOperand(2));
       }
       selected_val.is_valid &= cond.is_valid;
       return selected_val;
@@ -538,22 +651,26 @@ CrossReferenceResolverImpl::ResolveConstantExpr(llvm::ConstantExpr *ce) {
   return {};
 }
 
-// Try to resolve `val` as a cross-reference.
+// Evaluate a call, given the resolutions of its arguments.
 ResolvedCrossReference
-CrossReferenceResolverImpl::ResolveCall(llvm::CallInst *call) {
+CrossReferenceResolverImpl::EvaluateCall(llvm::CallInst *call,
+                                         const ResolutionMap &results) {
+  const auto get = [&results](llvm::Value *val) {
+    return Lookup(results, val);
+  };
   switch (call->getIntrinsicID()) {
     case llvm::Intrinsic::ctlz: {
-      auto xr = ResolveValue(call->getArgOperand(0));
+      auto xr = get(call->getArgOperand(0));
       xr.u.address = __builtin_clzl(xr.u.address);
       return xr;
     }
     case llvm::Intrinsic::cttz: {
-      auto xr = ResolveValue(call->getArgOperand(0));
+      auto xr = get(call->getArgOperand(0));
       xr.u.address = __builtin_ctzl(xr.u.address);
       return xr;
     }
     case llvm::Intrinsic::ctpop: {
-      auto xr = ResolveValue(call->getArgOperand(0));
+      auto xr = get(call->getArgOperand(0));
       xr.u.address = __builtin_popcountl(xr.u.address);
       return xr;
     }
@@ -568,7 +685,7 @@ CrossReferenceResolverImpl::ResolveCall(llvm::CallInst *call) {
   // Looks like a call through a type hint function.
   if (auto func = call->getCalledFunction();
       func && func->getName().startswith(kTypeHintFunctionPrefix)) {
-    auto xr = ResolveValue(call->getArgOperand(0));
+    auto xr = get(call->getArgOperand(0));
     xr.hinted_value_type = func->getReturnType()->getPointerElementType();
     xr.displacement_from_hinted_value_type = 0;
     return xr;
@@ -579,18 +696,136 @@ CrossReferenceResolverImpl::ResolveCall(llvm::CallInst *call) {
   }
 }
 
+// Returns the resolution of `val` in `results`, or an invalid resolution if
+// `val` hasn't been resolved, e.g. because it is part of a cycle.
+ResolvedCrossReference
+CrossReferenceResolverImpl::Lookup(const ResolutionMap &results,
+                                   llvm::Value *val) {
+  if (auto it = results.find(val); it != results.end()) {
+    return it->second;
+  } else {
+    return {};
+  }
+}
+
+// Collect the operands of `val` whose resolutions are needed to evaluate
+// `val`. This must agree with the `Evaluate*` methods.
+void CrossReferenceResolverImpl::CollectDependencies(
+    llvm::Value *val, llvm::SmallVectorImpl<llvm::Value *> &deps) {
+
+  if (auto ce = llvm::dyn_cast<llvm::ConstantExpr>(val)) {
+    if (!address_of_entity(ce)) {
+      for (auto &op : ce->operands()) {
+        deps.push_back(op.get());
+      }
+    }
+
+  } else if (auto call = llvm::dyn_cast<llvm::CallInst>(val)) {
+    if (call->getNumArgOperands()) {
+      deps.push_back(call->getArgOperand(0));
+    }
+
+  } else if (auto inst = llvm::dyn_cast<llvm::Instruction>(val)) {
+    switch (inst->getOpcode()) {
+      case llvm::Instruction::Add:
+      case llvm::Instruction::Sub:
+      case llvm::Instruction::Mul:
+      case llvm::Instruction::And:
+      case llvm::Instruction::Or:
+      case llvm::Instruction::Xor:
+      case llvm::Instruction::Shl:
+      case llvm::Instruction::LShr:
+      case llvm::Instruction::AShr:
+      case llvm::Instruction::SDiv:
+      case llvm::Instruction::UDiv:
+      case llvm::Instruction::SRem:
+      case llvm::Instruction::URem:
+        deps.push_back(inst->getOperand(0));
+        deps.push_back(inst->getOperand(1));
+        break;
+      case llvm::Instruction::ZExt:
+      case llvm::Instruction::SExt:
+      case llvm::Instruction::Trunc:
+      case llvm::Instruction::IntToPtr:
+      case llvm::Instruction::PtrToInt:
+      case llvm::Instruction::BitCast:
+        deps.push_back(inst->getOperand(0));
+        break;
+      default: break;
+    }
+  }
+}
+
 // Try to resolve `val` as a cross-reference.
+//
+// NOTE(pag): LLVM tends to fold `__anvill_pc`-relative expressions into very
+//            deep constant expressions that share lots of sub-expressions.
+//            We evaluate the expression DAG in post-order using an explicit
+//            stack, so that deep expressions can't overflow the native stack,
+//            and so that each shared sub-expression is evaluated only once.
 ResolvedCrossReference
 CrossReferenceResolverImpl::ResolveValue(llvm::Value *val) {
-  if (auto const_val = llvm::dyn_cast<llvm::Constant>(val)) {
-    return ResolveConstant(const_val);
+  if (!llvm::isa<llvm::Constant>(val) && !llvm::isa<llvm::Instruction>(val)) {
+    return {};
+  }
 
-  } else if (auto inst_val = llvm::dyn_cast<llvm::Instruction>(val)) {
-    return ResolveInstruction(inst_val);
+  ResolutionMap results;
+  std::unordered_set<llvm::Value *> expanded;
+  std::vector<std::pair<llvm::Value *, bool>> stack;
+  llvm::SmallVector<llvm::Value *, 4> deps;
 
-  } else {
-    return {};
+  stack.emplace_back(val, false);
+  while (!stack.empty()) {
+    const auto [node, deps_resolved] = stack.back();
+    stack.pop_back();
+
+    if (results.count(node)) {
+      continue;
+    }
+
+    // All dependencies of `node` are resolved, so now we can evaluate it.
+    if (deps_resolved) {
+      if (auto const_val = llvm::dyn_cast<llvm::Constant>(node)) {
+        const auto xr = EvaluateConstant(const_val, results);
+        xref_cache.Insert(const_val, xr);
+        results.emplace(node, xr);
+
+      } else if (auto inst_val = llvm::dyn_cast<llvm::Instruction>(node)) {
+        results.emplace(node, EvaluateInstruction(inst_val, results));
+
+      } else {
+        results.emplace(node, ResolvedCrossReference{});
+      }
+      continue;
+    }
+
+    // Constants may have been resolved by an earlier query.
+    if (auto const_val = llvm::dyn_cast<llvm::Constant>(node)) {
+      ResolvedCrossReference xr = {};
+      if (xref_cache.Find(const_val, xr)) {
+        results.emplace(node, xr);
+        continue;
+      }
+    }
+
+    // We're already in the middle of resolving `node`, i.e. there's a cycle
+    // (e.g. through a PHI node). Users of `node` will see it as unresolved.
+    if (!expanded.insert(node).second) {
+      continue;
+    }
+
+    stack.emplace_back(node, true);
+
+    deps.clear();
+    CollectDependencies(node, deps);
+    for (auto dep : deps) {
+      if (!results.count(dep)) {
+        stack.emplace_back(dep, false);
+      }
+    }
   }
+
+  return Lookup(results, val);
 }
 
 // Returns the "magic" value that represents the return address.
@@ -603,6 +838,43 @@ uint64_t CrossReferenceResolverImpl::MagicReturnAddressValue(void) const {
   }
 }
 
+CrossReferenceCache::CrossReferenceCache(void)
+    : impl(new CrossReferenceCacheImpl) {}
+
+CrossReferenceCache::~CrossReferenceCache(void) {}
+
+CrossReferenceCache::Ptr CrossReferenceCache::Create(void) {
+  return Ptr(new CrossReferenceCache);
+}
+
+// Drop the cached resolution of `val`, if any.
+void CrossReferenceCache::Invalidate(llvm::Constant *val) const {
+  impl->Erase(val);
+}
+
+// Drop all cached resolutions.
+void CrossReferenceCache::Clear(void) const {
+  impl->Clear();
+}
+
+// Returns `true` if there is a cached resolution of `val`.
+bool CrossReferenceCache::Contains(llvm::Constant *val) const {
+  std::shared_lock<std::shared_mutex> locker(impl->lock);
+  return impl->entries.count(val) != 0u;
+}
+
+// Returns the current statistics of this cache.
+CrossReferenceCacheStatistics CrossReferenceCache::Statistics(void) const {
+  CrossReferenceCacheStatistics stats;
+  stats.num_hits = impl->num_hits.load();
+  stats.num_misses = impl->num_misses.load();
+  stats.num_invalidations = impl->num_invalidations.load();
+
+  std::shared_lock<std::shared_mutex> locker(impl->lock);
+  stats.num_entries = impl->entries.size();
+  return stats;
+}
+
 CrossReferenceResolver::~CrossReferenceResolver(void) {}
 
 // The primary way of using a cross-reference resolver is with an entity
@@ -616,18 +888,20 @@ CrossReferenceResolver::CrossReferenceResolver(const EntityLifter &lifter)
           [=](uint64_t addr) -> llvm::Constant * {
             llvm::Constant *ret = nullptr;
             return ret;
-          })) {}
+          },
+          lifter.CrossReferenceCache())) {}
 
 // In the absence of an entity lifter, we need a DataLayout to determine
 // offsets, etc.
 CrossReferenceResolver::CrossReferenceResolver(const llvm::DataLayout &dl)
     : impl(std::make_shared<CrossReferenceResolverImpl>(
           dl, [](llvm::Constant *) { return std::nullopt; },
-          [](uint64_t) -> llvm::Constant * { return nullptr; })) {}
+          [](uint64_t) -> llvm::Constant * { return nullptr; },
+          CrossReferenceCache::Create())) {}
 
-// Clear the internal cache.
+// Clear the cache.
 void CrossReferenceResolver::ClearCache(void) const {
-  impl->xref_cache.clear();
+  impl->xref_cache.Clear();
 }
 
 // Try to resolve `val` as a cross-reference.
@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2021 Trail of Bits, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <anvill/Analysis/StackPointerResolver.h>
+#include <anvill/Analysis/Utils.h>
+#include <llvm/ADT/APInt.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/DenseSet.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/DataLayout.h>
+#include <llvm/IR/InstrTypes.h>
+#include <llvm/IR/Instruction.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Operator.h>
+
+#include <utility>
+#include <vector>
+
+namespace anvill {
+
+class StackPointerResolverImpl {
+ public:
+  explicit StackPointerResolverImpl(const llvm::DataLayout &dl_) : dl(dl_) {}
+
+  // Collect the values from which `val` may derive the stack pointer. If there
+  // are none, then `val` is related to the stack pointer only if it is the
+  // stack pointer itself.
+  void CollectDependencies(llvm::Value *val,
+                           llvm::SmallVectorImpl<llvm::Value *> &deps) const;
+
+  bool IsRelatedToStackPointer(llvm::Value *val);
+
+  const llvm::DataLayout &dl;
+
+  // Memoized answers.
+  llvm::DenseMap<llvm::Value *, bool> results;
+};
+
+void StackPointerResolverImpl::CollectDependencies(
+    llvm::Value *val, llvm::SmallVectorImpl<llvm::Value *> &deps) const {
+
+  if (auto pti = llvm::dyn_cast<llvm::PtrToIntOperator>(val)) {
+    deps.push_back(pti->getOperand(0));
+
+  } else if (auto ce = llvm::dyn_cast<llvm::ConstantExpr>(val)) {
+    switch (ce->getOpcode()) {
+      case llvm::Instruction::IntToPtr:
+      case llvm::Instruction::PtrToInt:
+      case llvm::Instruction::BitCast:
+      case llvm::Instruction::GetElementPtr:
+      case llvm::Instruction::Shl:
+      case llvm::Instruction::LShr:
+      case llvm::Instruction::AShr:
+      case llvm::Instruction::UDiv:
+      case llvm::Instruction::SDiv: deps.push_back(ce->getOperand(0)); break;
+      case llvm::Instruction::Add:
+      case llvm::Instruction::Sub:
+      case llvm::Instruction::Mul:
+      case llvm::Instruction::And:
+      case llvm::Instruction::Or:
+      case llvm::Instruction::Xor:
+        deps.push_back(ce->getOperand(0));
+        deps.push_back(ce->getOperand(1));
+        break;
+      case llvm::Instruction::Select:
+        deps.push_back(ce->getOperand(1));
+        deps.push_back(ce->getOperand(2));
+        break;
+      default: break;
+    }
+
+  } else if (auto op2 = llvm::dyn_cast<llvm::BinaryOperator>(val)) {
+    deps.push_back(op2->getOperand(0));
+    deps.push_back(op2->getOperand(1));
+
+  } else if (auto op1 = llvm::dyn_cast<llvm::UnaryOperator>(val)) {
+    deps.push_back(op1->getOperand(0));
+
+  } else if (auto sel = llvm::dyn_cast<llvm::SelectInst>(val)) {
+    deps.push_back(sel->getTrueValue());
+    deps.push_back(sel->getFalseValue());
+
+  } else if (auto val2 = val->stripPointerCastsAndAliases();
+             val2 && val2 != val) {
+    deps.push_back(val2);
+
+  } else {
+    llvm::APInt ap(dl.getPointerSizeInBits(0), 0);
+    if (auto val3 = val->stripAndAccumulateConstantOffsets(dl, ap, true);
+        val3 && val3 != val) {
+      deps.push_back(val3);
+    }
+  }
+}
+
+// Evaluates `root` in post-order using an explicit stack, so that long
+// derivation chains don't exhaust the native stack. Every value visited along
+// the way has its answer memoized, unless that answer is provisional.
+bool StackPointerResolverImpl::IsRelatedToStackPointer(llvm::Value *root) {
+  if (auto it = results.find(root); it != results.end()) {
+    return it->second;
+  }
+
+  // The `bool` tells us whether or not the dependencies of the value have
+  // already been pushed.
+  std::vector<std::pair<llvm::Value *, bool>> work_list;
+  llvm::DenseSet<llvm::Value *> expanded;
+  llvm::DenseSet<llvm::Value *> provisional;
+  llvm::SmallVector<llvm::Value *, 4> deps;
+
+  work_list.emplace_back(root, false);
+  while (!work_list.empty()) {
+    const auto [val, deps_pushed] = work_list.back();
+    work_list.pop_back();
+
+    if (results.count(val)) {
+      continue;
+    }
+
+    deps.clear();
+    CollectDependencies(val, deps);
+
+    if (deps_pushed) {
+      auto related = false;
+      auto is_provisional = false;
+      if (deps.empty()) {
+        related = IsStackPointer(val);
+
+      // NOTE(pag): A dependency without an answer is one that is still being
+      //            evaluated further down the work list, i.e. `val` is part of
+      //            a cycle (e.g. through a `select` in unreachable code). It is
+      //            treated as not related for now, which makes the answer for
+      //            `val` provisional: it may be wrong if `val` can reach the
+      //            stack pointer through the rest of the cycle.
+      } else {
+        for (auto dep : deps) {
+          if (auto it = results.find(dep); it == results.end()) {
+            is_provisional = true;
+          } else if (it->second) {
+            related = true;
+            break;
+          } else if (provisional.count(dep)) {
+            is_provisional = true;
+          }
+        }
+      }
+      results.try_emplace(val, related);
+      if (!related && is_provisional) {
+        provisional.insert(val);
+      }
+
+    } else if (expanded.insert(val).second) {
+      work_list.emplace_back(val, true);
+      for (auto dep : deps) {
+        if (!results.count(dep)) {
+          work_list.emplace_back(dep, false);
+        }
+      }
+    }
+  }
+
+  // Only `root` is known to have explored every one of its cycles, so the
+  // provisional answers of the other values aren't memoized. They'll be
+  // re-evaluated if asked about directly.
+  provisional.erase(root);
+  for (auto val : provisional) {
+    results.erase(val);
+  }
+
+  return results[root];
+}
+
+StackPointerResolver::~StackPointerResolver(void) {}
+
+StackPointerResolver::StackPointerResolver(const llvm::DataLayout &dl)
+    : impl(new StackPointerResolverImpl(dl)) {}
+
+// Returns `true` if it looks like `val` is derived from a symbolic stack
+// pointer representation.
+bool StackPointerResolver::IsRelatedToStackPointer(llvm::Value *val) const {
+  return impl->IsRelatedToStackPointer(val);
+}
+
+// Forget all memoized answers.
+void StackPointerResolver::Clear(void) {
+  impl->results.clear();
+}
+
+}  // namespace anvill
@@ -16,6 +16,7 @@
  */
 
 #include <anvill/ABI.h>
+#include <anvill/Analysis/StackPointerResolver.h>
 #include <anvill/Analysis/Utils.h>
 #include <llvm/ADT/Triple.h>
 #include <llvm/IR/DataLayout.h>
@@ -118,65 +119,6 @@ static bool IsCallRelatedToStackPointerItrinsic(llvm::CallBase *call) {
 
 }  // namespace
 
-// Returns `true` if it looks like `val` is derived from a symbolic stack
-// pointer representation.
-bool IsRelatedToStackPointer(const llvm::DataLayout &dl, llvm::Value *val) {
-
-  if (auto pti = llvm::dyn_cast<llvm::PtrToIntOperator>(val)) {
-    return IsRelatedToStackPointer(dl, pti->getOperand(0));
-
-  } else if (auto ce = llvm::dyn_cast<llvm::ConstantExpr>(val)) {
-    switch (ce->getOpcode()) {
-      case llvm::Instruction::IntToPtr:
-      case llvm::Instruction::PtrToInt:
-      case llvm::Instruction::BitCast:
-      case llvm::Instruction::GetElementPtr:
-      case llvm::Instruction::Shl:
-      case llvm::Instruction::LShr:
-      case llvm::Instruction::AShr:
-      case llvm::Instruction::UDiv:
-      case llvm::Instruction::SDiv:
-        return IsRelatedToStackPointer(dl, ce->getOperand(0));
-      case llvm::Instruction::Add:
-      case llvm::Instruction::Sub:
-      case llvm::Instruction::Mul:
-      case llvm::Instruction::And:
-      case llvm::Instruction::Or:
-      case llvm::Instruction::Xor:
-        return IsRelatedToStackPointer(dl, ce->getOperand(0)) ||
-               IsRelatedToStackPointer(dl, ce->getOperand(1));
-      case llvm::Instruction::Select:
-        return IsRelatedToStackPointer(dl, ce->getOperand(1)) ||
-               IsRelatedToStackPointer(dl, ce->getOperand(2));
-      default: return false;
-    }
-
-  } else if (auto op2 = llvm::dyn_cast<llvm::BinaryOperator>(val)) {
-    return IsRelatedToStackPointer(dl, op2->getOperand(0)) ||
-           IsRelatedToStackPointer(dl, op2->getOperand(1));
-
-  } else if (auto op1 = llvm::dyn_cast<llvm::UnaryOperator>(val)) {
-    return IsRelatedToStackPointer(dl, op1->getOperand(0));
-
-  } else if (auto sel = llvm::dyn_cast<llvm::SelectInst>(val)) {
-    return IsRelatedToStackPointer(dl, sel->getTrueValue()) ||
-           IsRelatedToStackPointer(dl, sel->getFalseValue());
-
-  } else if (auto val2 = val->stripPointerCastsAndAliases();
-             val2 && val2 != val) {
-    return IsRelatedToStackPointer(dl, val2);
-
-  } else {
-    llvm::APInt ap(dl.getPointerSizeInBits(0), 0);
-    if (auto val3 = val->stripAndAccumulateConstantOffsets(dl, ap, true);
-        val3 && val3 != val) {
-      return IsRelatedToStackPointer(dl, val3);
-    } else {
-      return IsStackPointer(val);
-    }
-  }
-}
-
 // Returns `true` if it looks like `val` is the stack counter.
 bool IsStackPointer(llvm::Value *val) {
   if (auto gv = llvm::dyn_cast<llvm::GlobalVariable>(val)) {
@@ -235,6 +177,12 @@ bool IsReturnAddress(llvm::Value *val) {
   }
 }
 
+// Returns `true` if it looks like `val` is derived from a symbolic stack
+// pointer representation.
+bool IsRelatedToStackPointer(const llvm::DataLayout &dl, llvm::Value *val) {
+  return StackPointerResolver(dl).IsRelatedToStackPointer(val);
+}
+
 // Returns `true` if `val` looks like it is backed by a definition, and thus can
 // be the aliasee of an `llvm::GlobalAlias`.
 bool CanBeAliased(llvm::Value *val) {
@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2021 Trail of Bits, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <anvill/ExternalData.h>
+#include <llvm/IR/GlobalVariable.h>
+#include <llvm/IR/ValueHandle.h>
+#include <llvm/Support/FormatVariadic.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <unordered_map>
+#include <vector>
+
+namespace anvill {
+
+// Where the contents of one variable are in the blob.
+struct ExternalDataEntry {
+  llvm::WeakVH var;
+  uint64_t address{0};
+  uint64_t offset{0};
+  uint64_t size{0};
+};
+
+class ExternalDataImpl {
+ public:
+  explicit ExternalDataImpl(llvm::raw_ostream &blob_os_) : blob_os(blob_os_) {}
+
+  llvm::raw_ostream &blob_os;
+
+  // Number of bytes written to `blob_os`.
+  uint64_t blob_size{0};
+
+  std::vector<ExternalDataEntry> entries;
+
+  // Maps variables to their index in `entries`.
+  std::unordered_map<llvm::GlobalVariable *, size_t> var_to_entry;
+};
+
+ExternalData::ExternalData(llvm::raw_ostream &blob_os)
+    : impl(new ExternalDataImpl(blob_os)) {}
+
+ExternalData::~ExternalData(void) {}
+
+// Append `bytes`, the contents of `var`, which is located at `address`, to
+// the blob.
+uint64_t ExternalData::Add(llvm::GlobalVariable *var, uint64_t address,
+                           std::string_view bytes, uint64_t alignment) {
+  if (alignment > 1u) {
+    if (auto misalignment = impl->blob_size % alignment) {
+      const auto padding = alignment - misalignment;
+      impl->blob_os.write_zeros(static_cast<unsigned>(padding));
+      impl->blob_size += padding;
+    }
+  }
+
+  const auto offset = impl->blob_size;
+  impl->blob_os.write(bytes.data(), bytes.size());
+  impl->blob_size += bytes.size();
+
+  impl->var_to_entry[var] = impl->entries.size();
+  impl->entries.push_back(
+      ExternalDataEntry{llvm::WeakVH(var), address, offset, bytes.size()});
+  return offset;
+}
+
+// Returns `true` if the contents of `var` are in the blob.
+bool ExternalData::Contains(llvm::GlobalVariable *var) const {
+  auto it = impl->var_to_entry.find(var);
+
+  // NOTE(pag): The original variable might have been deleted, and a new one
+  //            allocated at the same address.
+  return it != impl->var_to_entry.end() &&
+         impl->entries[it->second].var == var;
+}
+
+// Returns the number of bytes written to the blob, including padding.
+uint64_t ExternalData::Size(void) const {
+  return impl->blob_size;
+}
+
+// Print out the manifest as a JSON document.
+void ExternalData::PrintManifestJSON(llvm::raw_ostream &os) const {
+  llvm::json::Array vars;
+  for (const auto &entry : impl->entries) {
+    llvm::Value *var = entry.var;
+    if (!var) {
+      continue;
+    }
+    vars.push_back(llvm::json::Object{
+        {"name", var->getName().str()},
+        {"address", static_cast<int64_t>(entry.address)},
+        {"offset", static_cast<int64_t>(entry.offset)},
+        {"size", static_cast<int64_t>(entry.size)}});
+  }
+
+  llvm::json::Value doc(
+      llvm::json::Object{{"blob_size", static_cast<int64_t>(impl->blob_size)},
+                         {"variables", std::move(vars)}});
+
+  os << llvm::formatv("{0:2}", doc) << '\n';
+}
+
+}  // namespace anvill
@@ -20,15 +20,21 @@
 #include <anvill/ABI.h>
 #include <anvill/Analysis/Utils.h>
 #include <anvill/Decl.h>
+#include <anvill/ExternalData.h>
 #include <anvill/Providers/MemoryProvider.h>
 #include <anvill/TypePrinter.h>
 #include <glog/logging.h>
 #include <llvm/ADT/APInt.h>
+#include <llvm/IR/Constants.h>
 #include <llvm/IR/GlobalAlias.h>
+#include <llvm/IR/GlobalVariable.h>
 #include <llvm/IR/Module.h>
 #include <remill/BC/Util.h>
 
+#include <algorithm>
 #include <sstream>
+#include <unordered_set>
+#include <vector>
 
 #include "EntityLifter.h"
 
@@ -147,10 +153,6 @@ llvm::Constant *DataLifter::LiftData(const GlobalVarDecl &decl,
   const auto &dl = options.module->getDataLayout();
   const auto type = remill::RecontextualizeType(decl.type, context);
 
-  std::vector<uint8_t> bytes;
-  llvm::Constant *value = nullptr;
-  bool bytes_accessable = false;
-
   std::stringstream ss2;
   ss2 << kGlobalVariableNamePrefix << std::hex << decl.address << '_'
       << TranslateType(*type, dl, true);
@@ -161,52 +163,213 @@ llvm::Constant *DataLifter::LiftData(const GlobalVarDecl &decl,
     return var;
   }
 
-  // Inspect the availability of first byte at `decl.address` and append
-  // it into the bytes vector
-  const auto data_size = dl.getTypeAllocSize(type);
-  auto [first_byte, first_byte_avail, first_byte_perms] =
-      memory_provider.Query(decl.address);
-  if (MemoryProvider::HasByte(first_byte_avail)) {
-    bytes.push_back(first_byte);
-    bytes_accessable = true;
-  }
-
-  // Inspect the read/write permission of bytes and check if it is crossing
-  // permission boundaries. Log error in such case
-  if (bytes_accessable) {
-    for (auto i = 1U; i < data_size; ++i) {
-      auto [byte, byte_avail, byte_perms] =
-          memory_provider.Query(decl.address + i);
-      if (!MemoryProvider::HasByte(byte_avail)) {
-
-        bytes_accessable = false;
-        LOG(ERROR) << "Variable at address " << std::hex << decl.address
-                   << " crosses into inaccessible bytes (Byte offset " << i
-                   << " )!" << std::dec;
-        break;
-      } else if (first_byte_perms != byte_perms) {
-        bytes_accessable = false;
-        LOG(ERROR) << "Variable at address " << std::hex << decl.address
-                   << " crosses permission (Byte offset " << i << " )!"
-                   << std::dec;
-        break;
-      }
-
-      bytes.push_back(byte);
-    }
+  // Defer reading the variable's bytes until something asks for them.
+  if (options.lazy_data_initializers) {
+    var = new llvm::GlobalVariable(*options.module, type, false,
+                                   llvm::GlobalValue::ExternalLinkage, nullptr,
+                                   var_name);
+    pending_initializers.emplace_back(var, decl.address);
+    return var;
   }
 
-  if (bytes_accessable) {
-    value = lifter_context.value_lifter.Lift(
-        std::string_view(reinterpret_cast<char *>(bytes.data()), bytes.size()),
-        type, lifter_context, decl.address);
+  // Keep the bulk bytes out of the module.
+  if (IsExternalData(type)) {
+    var = new llvm::GlobalVariable(*options.module, type, false,
+                                   llvm::GlobalValue::ExternalLinkage, nullptr,
+                                   var_name);
+    AddExternalData(var, decl.address);
+    return var;
   }
 
+  const auto value = LiftInitializer(decl.address, type, lifter_context);
   return new llvm::GlobalVariable(*options.module, type, false,
                                   llvm::GlobalValue::ExternalLinkage, value,
                                   var_name);
 }
 
+// Read the bytes of a variable of type `type` at `address` into `bytes`.
+// Returns `false` if the bytes aren't accessible.
+bool DataLifter::ReadData(uint64_t address, llvm::Type *type,
+                          std::vector<uint8_t> &bytes) {
+  const auto &dl = options.module->getDataLayout();
+  const auto data_size = static_cast<uint64_t>(dl.getTypeAllocSize(type));
+
+  // Read the bytes of the variable, stopping at the first byte that is not
+  // accessible, or that crosses a permission boundary.
+  const auto num_read = memory_provider.ReadBytes(address, data_size, bytes);
+  if (!num_read) {
+    return false;
+  }
+
+  // Log why we stopped early.
+  if (num_read < data_size) {
+    auto [byte, byte_avail, byte_perms] =
+        memory_provider.Query(address + num_read);
+    if (!MemoryProvider::HasByte(byte_avail)) {
+      LOG(ERROR) << "Variable at address " << std::hex << address
+                 << " crosses into inaccessible bytes (Byte offset "
+                 << num_read << " )!" << std::dec;
+    } else {
+      LOG(ERROR) << "Variable at address " << std::hex << address
+                 << " crosses permission (Byte offset " << num_read << " )!"
+                 << std::dec;
+    }
+    return false;
+  }
+
+  return true;
+}
+
+// Read the bytes of a variable of type `type` at `address`, and lift them
+// into an initializer. Returns `nullptr` if the bytes aren't accessible.
+llvm::Constant *DataLifter::LiftInitializer(uint64_t address, llvm::Type *type,
+                                            EntityLifterImpl &lifter_context) {
+  std::vector<uint8_t> bytes;
+  if (!ReadData(address, type, bytes)) {
+    return nullptr;
+  }
+
+  return lifter_context.value_lifter.Lift(
+      std::string_view(reinterpret_cast<char *>(bytes.data()), bytes.size()),
+      type, lifter_context, address);
+}
+
+// Returns `true` if the contents of variables of type `type` should be
+// added to `options.external_data` instead of being lifted.
+bool DataLifter::IsExternalData(llvm::Type *type) const {
+  if (!options.external_data || !options.external_data_threshold) {
+    return false;
+  }
+
+  // NOTE(pag): Pointers inside of the data would need to be lifted into
+  //            cross-references, so we keep such variables in the module.
+  const auto &dl = options.module->getDataLayout();
+  return static_cast<uint64_t>(dl.getTypeAllocSize(type)) >=
+             options.external_data_threshold &&
+         ValueLifterImpl::IsPointerFree(type);
+}
+
+// Read the bytes of `var`, located at `address`, and add them to
+// `options.external_data`.
+bool DataLifter::AddExternalData(llvm::GlobalVariable *var, uint64_t address) {
+  const auto type = var->getValueType();
+  std::vector<uint8_t> bytes;
+  if (!ReadData(address, type, bytes)) {
+    return false;
+  }
+
+  const auto &dl = options.module->getDataLayout();
+  options.external_data->Add(
+      var, address,
+      std::string_view(reinterpret_cast<char *>(bytes.data()), bytes.size()),
+      dl.getABITypeAlignment(type));
+  return true;
+}
+
+// Initialize `var`, the lifted variable at `address`, if it was declared
+// without an initializer.
+bool DataLifter::InitializeData(llvm::GlobalVariable *var, uint64_t address,
+                                EntityLifterImpl &lifter_context) {
+  if (var->hasInitializer()) {
+    return false;
+  }
+
+  // The contents of large variables go outside of the module.
+  if (IsExternalData(var->getValueType())) {
+    return !options.external_data->Contains(var) &&
+           AddExternalData(var, address);
+  }
+
+  // NOTE(pag): Lifting the initializer may reference `var` itself, e.g. via
+  //            a self-referencing pointer, which is fine as `var` already
+  //            exists.
+  if (auto value =
+          LiftInitializer(address, var->getValueType(), lifter_context)) {
+    var->setInitializer(value);
+    return true;
+  }
+  return false;
+}
+
+namespace {
+
+// Returns `true` if `gv` is used by something other than `llvm.used` or
+// `llvm.compiler.used`, either directly, or via constant expressions and
+// aliases.
+static bool IsReferenced(llvm::GlobalValue *gv) {
+  std::vector<llvm::User *> work_list(gv->user_begin(), gv->user_end());
+  std::unordered_set<llvm::User *> seen;
+  while (!work_list.empty()) {
+    const auto user = work_list.back();
+    work_list.pop_back();
+    if (!seen.insert(user).second) {
+      continue;
+    }
+
+    if (auto user_var = llvm::dyn_cast<llvm::GlobalVariable>(user)) {
+      const auto name = user_var->getName();
+      if (name != "llvm.used" && name != "llvm.compiler.used") {
+        return true;
+      }
+
+    } else if (llvm::isa<llvm::GlobalAlias>(user) ||
+               llvm::isa<llvm::ConstantExpr>(user) ||
+               llvm::isa<llvm::ConstantAggregate>(user)) {
+      work_list.insert(work_list.end(), user->user_begin(), user->user_end());
+
+    // E.g. an instruction.
+    } else {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+// Initialize the variables that were lazily declared by `LiftData`.
+unsigned DataLifter::MaterializePendingData(EntityLifterImpl &lifter_context,
+                                            bool only_referenced) {
+  std::vector<std::pair<uint64_t, llvm::GlobalVariable *>> ready;
+  std::vector<std::pair<llvm::WeakVH, uint64_t>> still_pending;
+  unsigned num_initialized = 0u;
+
+  // Lifting initializers can declare new variables, e.g. for pointers inside
+  // of the initializers, so we go until we stop finding variables to
+  // initialize.
+  for (auto changed = true; changed;) {
+    changed = false;
+    ready.clear();
+    still_pending.clear();
+
+    for (auto &[handle, address] : pending_initializers) {
+      llvm::Value *val = handle;
+      auto var = llvm::dyn_cast_or_null<llvm::GlobalVariable>(val);
+      if (!var || var->hasInitializer()) {
+        continue;
+      } else if (only_referenced && !IsReferenced(var)) {
+        still_pending.emplace_back(var, address);
+      } else {
+        ready.emplace_back(address, var);
+      }
+    }
+
+    pending_initializers.swap(still_pending);
+
+    // Read memory in address order, so that nearby variables are read from
+    // the same byte sequences.
+    std::sort(ready.begin(), ready.end());
+    for (auto [address, var] : ready) {
+      if (InitializeData(var, address, lifter_context)) {
+        ++num_initialized;
+      }
+      changed = true;
+    }
+  }
+
+  return num_initialized;
+}
+
 // Declare a lifted a variable. Will return `nullptr` if the memory is
 // not accessible.
 llvm::Constant *EntityLifter::DeclareEntity(const GlobalVarDecl &decl) const {
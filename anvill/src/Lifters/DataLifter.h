@@ -19,15 +19,19 @@
 
 #include <anvill/Decl.h>
 #include <anvill/Lifters/Options.h>
+#include <llvm/IR/ValueHandle.h>
 
 #include <cstdint>
 #include <map>
 #include <memory>
 #include <set>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace llvm {
 class GlobalAlias;
+class GlobalVariable;
 class LLVMContext;
 class Module;
 class Type;
@@ -56,15 +60,50 @@ class DataLifter {
   llvm::Constant *GetOrDeclareData(const GlobalVarDecl &decl,
                                    EntityLifterImpl &lifter_context);
 
+  // Initialize `var`, the lifted variable at `address`, if it was declared
+  // without an initializer. Returns `true` if `var` was initialized, or if
+  // its contents were added to `options.external_data`.
+  bool InitializeData(llvm::GlobalVariable *var, uint64_t address,
+                      EntityLifterImpl &lifter_context);
+
+  // Initialize the variables that were lazily declared by `LiftData`. If
+  // `only_referenced` is `true`, then only variables that are referenced by
+  // something other than `llvm.used` or `llvm.compiler.used` are initialized.
+  // Returns the number of initialized variables.
+  unsigned MaterializePendingData(EntityLifterImpl &lifter_context,
+                                  bool only_referenced);
+
  private:
   friend class FunctionLifter;
 
+  // Read the bytes of a variable of type `type` at `address` into `bytes`.
+  // Returns `false` if the bytes aren't accessible.
+  bool ReadData(uint64_t address, llvm::Type *type,
+                std::vector<uint8_t> &bytes);
+
+  // Read the bytes of a variable of type `type` at `address`, and lift them
+  // into an initializer. Returns `nullptr` if the bytes aren't accessible.
+  llvm::Constant *LiftInitializer(uint64_t address, llvm::Type *type,
+                                  EntityLifterImpl &lifter_context);
+
+  // Returns `true` if the contents of variables of type `type` should be
+  // added to `options.external_data` instead of being lifted.
+  bool IsExternalData(llvm::Type *type) const;
+
+  // Read the bytes of `var`, located at `address`, and add them to
+  // `options.external_data`. Returns `false` if the bytes aren't accessible.
+  bool AddExternalData(llvm::GlobalVariable *var, uint64_t address);
+
   const LifterOptions &options;
   MemoryProvider &memory_provider;
   TypeProvider &type_provider;
 
   // Context associated with `module`.
   llvm::LLVMContext &context;
+
+  // Variables declared without initializers when lazily lifting data, along
+  // with their addresses.
+  std::vector<std::pair<llvm::WeakVH, uint64_t>> pending_initializers;
 };
 
 }  // namespace anvill
@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2021 Trail of Bits, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <anvill/Lifters/DecodeTable.h>
+#include <anvill/Providers/MemoryProvider.h>
+#include <glog/logging.h>
+#include <remill/Arch/Arch.h>
+#include <remill/Arch/Instruction.h>
+
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace anvill {
+
+class DecodeTableImpl {
+ public:
+  std::unordered_map<uint64_t, remill::Instruction> insts;
+};
+
+namespace {
+
+// Read the bytes of a possible instruction at `addr` into `inst`. This
+// follows the same rules as the function lifter, i.e. we stop at the first
+// unavailable or non-executable byte.
+static void ReadInstructionBytes(MemoryProvider &memory, uint64_t addr,
+                                 unsigned max_inst_size,
+                                 remill::Instruction &inst) {
+  inst.bytes.reserve(max_inst_size);
+  for (auto i = 0u; i < max_inst_size; ++i) {
+    auto [byte, accessible, perms] = memory.Query(addr + i);
+    if (!MemoryProvider::HasByte(accessible)) {
+      break;
+    }
+
+    switch (perms) {
+      case BytePermission::kUnknown:
+      case BytePermission::kReadableExecutable:
+      case BytePermission::kReadableWritableExecutable:
+        inst.bytes.push_back(static_cast<char>(byte));
+        continue;
+      case BytePermission::kReadable:
+      case BytePermission::kReadableWritable: break;
+    }
+    break;
+  }
+}
+
+// Add the statically known successors of `inst` to `work_list`.
+static void AddSuccessors(const remill::Instruction &inst,
+                          std::vector<uint64_t> &work_list) {
+  switch (inst.category) {
+    case remill::Instruction::kCategoryInvalid:
+    case remill::Instruction::kCategoryError:
+    case remill::Instruction::kCategoryIndirectJump:
+    case remill::Instruction::kCategoryFunctionReturn:
+    case remill::Instruction::kCategoryAsyncHyperCall: break;
+
+    case remill::Instruction::kCategoryNormal:
+    case remill::Instruction::kCategoryNoOp:
+      work_list.push_back(inst.next_pc);
+      break;
+
+    case remill::Instruction::kCategoryDirectJump:
+      work_list.push_back(inst.branch_taken_pc);
+      break;
+
+    case remill::Instruction::kCategoryConditionalIndirectJump:
+    case remill::Instruction::kCategoryConditionalFunctionReturn:
+    case remill::Instruction::kCategoryIndirectFunctionCall:
+    case remill::Instruction::kCategoryConditionalIndirectFunctionCall:
+    case remill::Instruction::kCategoryConditionalAsyncHyperCall:
+      work_list.push_back(inst.branch_not_taken_pc);
+      break;
+
+    case remill::Instruction::kCategoryDirectFunctionCall:
+    case remill::Instruction::kCategoryConditionalDirectFunctionCall:
+    case remill::Instruction::kCategoryConditionalBranch:
+      work_list.push_back(inst.branch_taken_pc);
+      work_list.push_back(inst.branch_not_taken_pc);
+      break;
+  }
+}
+
+// Decode everything reachable from the addresses in `work_list` into `insts`.
+static void DecodeReachable(const remill::Arch *arch, MemoryProvider &memory,
+                            std::vector<uint64_t> work_list,
+                            std::unordered_map<uint64_t, remill::Instruction>
+                                &insts) {
+  const auto max_inst_size = arch->MaxInstructionSize();
+  std::unordered_set<uint64_t> seen;
+
+  while (!work_list.empty()) {
+    const auto addr = work_list.back();
+    work_list.pop_back();
+    if (!seen.insert(addr).second) {
+      continue;
+    }
+
+    remill::Instruction inst;
+    ReadInstructionBytes(memory, addr, max_inst_size, inst);
+    if (inst.bytes.empty() ||
+        !arch->DecodeInstruction(addr, inst.bytes, inst)) {
+      continue;
+    }
+
+    AddSuccessors(inst, work_list);
+    insts.emplace(addr, std::move(inst));
+  }
+}
+
+}  // namespace
+
+DecodeTable::~DecodeTable(void) {}
+
+DecodeTable::DecodeTable(void) : impl(new DecodeTableImpl) {}
+
+// Decode all instructions reachable from the function entrypoints in
+// `func_addresses`, partitioning the entrypoints across `num_threads` threads.
+DecodeTable::ConstPtr
+DecodeTable::Create(const remill::Arch *arch, MemoryProvider &memory,
+                    const std::vector<uint64_t> &func_addresses,
+                    unsigned num_threads) {
+  std::shared_ptr<DecodeTable> table(new DecodeTable);
+  auto &insts = table->impl->insts;
+
+  num_threads = std::max(1u, num_threads);
+  if (num_threads == 1u) {
+    DecodeReachable(arch, memory, func_addresses, insts);
+    return table;
+  }
+
+  // Interleave the entrypoints across the threads. The entrypoints are
+  // typically sorted, so this spreads big and small regions of code evenly.
+  std::vector<std::vector<uint64_t>> partitions(num_threads);
+  for (size_t i = 0; i < func_addresses.size(); ++i) {
+    partitions[i % num_threads].push_back(func_addresses[i]);
+  }
+
+  std::vector<std::unordered_map<uint64_t, remill::Instruction>> thread_insts(
+      num_threads);
+  std::vector<std::thread> threads;
+  threads.reserve(num_threads);
+  for (auto i = 0u; i < num_threads; ++i) {
+    threads.emplace_back(DecodeReachable, arch, std::ref(memory),
+                         std::move(partitions[i]), std::ref(thread_insts[i]));
+  }
+
+  size_t num_insts = 0;
+  for (auto i = 0u; i < num_threads; ++i) {
+    threads[i].join();
+    num_insts += thread_insts[i].size();
+  }
+
+  // NOTE(pag): Threads may have speculatively decoded the same instructions,
+  //            e.g. shared callees. These decodings are identical.
+  insts.reserve(num_insts);
+  for (auto &partial_insts : thread_insts) {
+    for (auto &[addr, inst] : partial_insts) {
+      insts.emplace(addr, std::move(inst));
+    }
+  }
+
+  LOG(INFO) << "Pre-decoded " << insts.size() << " instructions from "
+            << func_addresses.size() << " functions using " << num_threads
+            << " threads";
+
+  return table;
+}
+
+// Return the pre-decoded, non-delayed instruction at `address`, or `nullptr`.
+const remill::Instruction *DecodeTable::Find(uint64_t address) const {
+  if (auto it = impl->insts.find(address); it != impl->insts.end()) {
+    return &(it->second);
+  } else {
+    return nullptr;
+  }
+}
+
+// Returns the number of pre-decoded instructions.
+size_t DecodeTable::Size(void) const {
+  return impl->insts.size();
+}
+
+}  // namespace anvill
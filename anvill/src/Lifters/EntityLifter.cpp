@@ -17,11 +17,17 @@
 
 #include "EntityLifter.h"
 
+#include <anvill/Analysis/CrossReferenceResolver.h>
+#include <anvill/Decl.h>
 #include <anvill/Providers/MemoryProvider.h>
 #include <anvill/Providers/TypeProvider.h>
 #include <glog/logging.h>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/IR/Constants.h>
 #include <llvm/IR/Function.h>
 #include <llvm/IR/GlobalAlias.h>
+#include <llvm/IR/GlobalVariable.h>
+#include <llvm/IR/InstIterator.h>
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/Module.h>
 #include <llvm/Transforms/Utils/ModuleUtils.h>
@@ -29,6 +35,7 @@
 #include <remill/BC/Util.h>
 
 #include <sstream>
+#include <unordered_set>
 
 namespace anvill {
 
@@ -41,6 +48,7 @@ EntityLifterImpl::EntityLifterImpl(
     : options(options_),
       memory_provider(mem_provider_),
       type_provider(type_provider_),
+      xref_cache(CrossReferenceCache::Create()),
       value_lifter(options),
       function_lifter(options, *mem_provider_, *type_provider_),
       data_lifter(options, *mem_provider_, *type_provider_) {
@@ -54,12 +62,70 @@ EntityLifterImpl::EntityLifterImpl(
 // view of the world remains consistent.
 void EntityLifterImpl::AddEntity(llvm::Constant *entity, uint64_t address) {
   CHECK_NOTNULL(entity);
-  address_to_entity[address].insert(entity);
-  if (auto [it, added] = entity_to_address.emplace(entity, address); added) {
-    if (auto gv = llvm::dyn_cast<llvm::GlobalValue>(entity); gv) {
-      llvm::GlobalValue *used[] = {gv};
-      llvm::appendToCompilerUsed(*(options.module), used);
+
+  auto &entities = IsReservedAddress(address)
+                       ? reserved_address_to_entity[address]
+                       : address_to_entity[address];
+  if (!llvm::is_contained(entities, entity)) {
+    entities.push_back(entity);
+  }
+
+  if (auto [it, added] = entity_to_address.try_emplace(entity, address);
+      added) {
+
+    // If `entity` was resolved before we knew it was an entity, then the
+    // resolutions of it and of any constant expressions using it are stale.
+    if (xref_cache->Contains(entity)) {
+      xref_cache->Clear();
+    }
+
+    if (llvm::isa<llvm::GlobalValue>(entity)) {
+      pending_compiler_used.emplace_back(entity);
+    }
+  }
+}
+
+// Returns the entities at `address`, or `nullptr` if there are none.
+const EntityLifterImpl::EntityList *
+EntityLifterImpl::EntitiesAtAddress(uint64_t address) const {
+  if (IsReservedAddress(address)) {
+    if (auto it = reserved_address_to_entity.find(address);
+        it != reserved_address_to_entity.end()) {
+      return &(it->second);
     }
+  } else if (auto it = address_to_entity.find(address);
+             it != address_to_entity.end()) {
+    return &(it->second);
+  }
+  return nullptr;
+}
+
+// Adds the global values registered by `AddEntity` since the last call to
+// `llvm.compiler.used`, so that they survive global dead code elimination.
+void EntityLifterImpl::MaterializeCompilerUsed(void) {
+  if (pending_compiler_used.empty()) {
+    return;
+  }
+
+  std::vector<llvm::GlobalValue *> used;
+  used.reserve(pending_compiler_used.size());
+  for (llvm::Value *val : pending_compiler_used) {
+
+    // NOTE(pag): The global may have been deleted, or replaced (e.g. a
+    //            declaration being replaced by a definition) since it was
+    //            registered.
+    if (!val) {
+      continue;
+    }
+    if (auto gv = llvm::dyn_cast<llvm::GlobalValue>(val->stripPointerCasts());
+        gv && gv->getParent() == options.module) {
+      used.push_back(gv);
+    }
+  }
+
+  pending_compiler_used.clear();
+  if (!used.empty()) {
+    llvm::appendToCompilerUsed(*(options.module), used);
   }
 }
 
@@ -76,22 +142,11 @@ EntityLifterImpl::AddressOfEntity(llvm::Constant *entity) const {
   }
 }
 
-// Applies a callback `cb` to each entity at a specified address.
-void EntityLifterImpl::ForEachEntityAtAddress(
-    uint64_t address, std::function<void(llvm::Constant *)> cb) const {
-  if (auto it = address_to_entity.find(address);
-      it != address_to_entity.end()) {
-    for (auto gv : it->second) {
-      cb(gv);
-    }
-  }
-}
-
 EntityLifter::~EntityLifter(void) {}
 
 EntityLifter::EntityLifter(
     const LifterOptions &options_,
-    const std::shared_ptr<MemoryProvider> &mem_provider_,
+    const std::shared_ptr<::anvill::MemoryProvider> &mem_provider_,
     const std::shared_ptr<::anvill::TypeProvider> &type_provider_)
     : impl(std::make_shared<EntityLifterImpl>(options_, mem_provider_,
                                               type_provider_)) {}
@@ -103,14 +158,194 @@ EntityLifter::AddressOfEntity(llvm::Constant *entity) const {
   return impl->AddressOfEntity(entity);
 }
 
+// Applies `cb` to the address of each function that is directly called by
+// the lifted function at `address`.
+void EntityLifter::ForEachDirectCallee(uint64_t address,
+                                       std::function<void(uint64_t)> cb) const {
+  if (auto it = impl->address_to_callees.find(address);
+      it != impl->address_to_callees.end()) {
+    for (auto callee_address : it->second) {
+      cb(callee_address);
+    }
+  }
+}
+
+// Adds the entities lifted or declared since the last call to
+// `llvm.compiler.used`.
+void EntityLifter::MaterializeCompilerUsed(void) const {
+  impl->MaterializeCompilerUsed();
+}
+
+// Initialize lazily declared variables.
+unsigned EntityLifter::MaterializeDataInitializers(bool only_referenced) const {
+  return impl->data_lifter.MaterializePendingData(*impl, only_referenced);
+}
+
+// Initialize the lifted variable `var` if it was declared without an
+// initializer.
+bool EntityLifter::MaterializeDataInitializer(llvm::Constant *var) const {
+  auto gv =
+      llvm::dyn_cast<llvm::GlobalVariable>(var->stripPointerCastsAndAliases());
+  if (!gv || gv->hasInitializer()) {
+    return false;
+  }
+
+  if (auto maybe_address = impl->AddressOfEntity(gv)) {
+    return impl->data_lifter.InitializeData(gv, *maybe_address, *impl);
+  } else {
+    return false;
+  }
+}
+
 // Return the options being used by this entity lifter.
 const LifterOptions &EntityLifter::Options(void) const {
   return impl->options;
 }
 
+// Return a reference to the memory provider for this entity lifter.
+MemoryProvider &EntityLifter::MemoryProvider(void) const {
+  return *(impl->memory_provider);
+}
+
 // Return a reference to the type provider for this entity lifter.
 TypeProvider &EntityLifter::TypeProvider(void) const {
   return *(impl->type_provider);
 }
 
+// Return the module-scoped cache of resolved cross-references.
+const std::shared_ptr<CrossReferenceCache> &
+EntityLifter::CrossReferenceCache(void) const {
+  return impl->xref_cache;
+}
+
+namespace {
+
+// Try to interpret `val` as a reference to some entity, or to some
+// `__anvill_pc`-relative address, and if so, add that address to `addresses`.
+// Plain integer constants are not references to anything.
+static void CollectReferencedAddress(const CrossReferenceResolver &xref_resolver,
+                                     llvm::Value *val,
+                                     std::vector<uint64_t> &addresses) {
+  const auto xref = xref_resolver.TryResolveReference(val);
+  if (!xref || xref.references_stack_pointer ||
+      xref.references_return_address) {
+    return;
+  }
+  if (xref.references_entity || xref.references_program_counter) {
+    addresses.push_back(xref.u.address);
+  }
+}
+
+// Collect the addresses of all entities referenced by the initializer of a
+// lifted variable.
+static void CollectReferencedAddresses(const EntityLifter &lifter,
+                                       llvm::Constant *var,
+                                       std::vector<uint64_t> &addresses) {
+  std::vector<llvm::Constant *> work_list;
+  std::unordered_set<llvm::Constant *> seen;
+
+  var = var->stripPointerCastsAndAliases();
+  if (auto gv = llvm::dyn_cast<llvm::GlobalVariable>(var);
+      gv && gv->hasInitializer()) {
+    work_list.push_back(gv->getInitializer());
+  }
+
+  while (!work_list.empty()) {
+    const auto val = work_list.back();
+    work_list.pop_back();
+    if (!seen.insert(val).second) {
+      continue;
+    }
+
+    if (llvm::isa<llvm::GlobalValue>(val)) {
+      if (auto maybe_addr = lifter.AddressOfEntity(val)) {
+        addresses.push_back(*maybe_addr);
+      }
+      continue;
+    }
+
+    for (auto &op : val->operands()) {
+      if (auto op_const = llvm::dyn_cast<llvm::Constant>(op.get())) {
+        work_list.push_back(op_const);
+      }
+    }
+  }
+}
+
+// Collect the addresses of all entities referenced by the lifted function
+// `func`. This includes direct callees, as well as anything that constant
+// operands might resolve to, e.g. `__anvill_pc`-relative data references.
+static void CollectReferencedAddresses(
+    const CrossReferenceResolver &xref_resolver, llvm::Function *func,
+    std::vector<uint64_t> &addresses) {
+  for (auto &inst : llvm::instructions(*func)) {
+    for (auto &op : inst.operands()) {
+      if (auto op_const = llvm::dyn_cast<llvm::Constant>(op.get())) {
+        CollectReferencedAddress(xref_resolver, op_const, addresses);
+      }
+    }
+  }
+}
+
+}  // namespace
+
+// Demand-driven lifting. Lift the functions and variables at each of the
+// addresses in `roots`, then transitively lift the functions and variables
+// that they reference.
+unsigned
+EntityLifter::LiftReachableEntities(const std::vector<uint64_t> &roots) const {
+  const auto &dl = impl->options.module->getDataLayout();
+  auto &types = *(impl->type_provider);
+  const CrossReferenceResolver xref_resolver(*this);
+
+  std::vector<uint64_t> work_list(roots.rbegin(), roots.rend());
+  std::vector<uint64_t> referenced_addresses;
+  std::unordered_set<uint64_t> seen;
+  unsigned num_lifted = 0u;
+
+  while (!work_list.empty()) {
+    const auto address = work_list.back();
+    work_list.pop_back();
+    if (!seen.insert(address).second) {
+      continue;
+    }
+
+    referenced_addresses.clear();
+
+    if (auto maybe_func = types.TryGetFunctionType(address)) {
+      if (auto func = LiftEntity(*maybe_func)) {
+        ++num_lifted;
+        CollectReferencedAddresses(xref_resolver, func, referenced_addresses);
+      }
+
+    } else if (auto maybe_var = types.TryGetVariableType(address, dl)) {
+
+      // `address` is inside of a variable; go lift the whole variable.
+      if (maybe_var->address != address) {
+        work_list.push_back(maybe_var->address);
+        continue;
+      }
+
+      if (auto var = LiftEntity(*maybe_var)) {
+        ++num_lifted;
+        CollectReferencedAddresses(*this, var, referenced_addresses);
+      }
+
+    } else {
+      continue;
+    }
+
+    // Visit the referenced entities in order of discovery.
+    for (auto it = referenced_addresses.rbegin();
+         it != referenced_addresses.rend(); ++it) {
+      if (!seen.count(*it)) {
+        work_list.push_back(*it);
+      }
+    }
+  }
+
+  impl->MaterializeCompilerUsed();
+  return num_lifted;
+}
+
 }  // namespace anvill
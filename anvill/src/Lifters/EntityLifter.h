@@ -17,14 +17,17 @@
 
 #pragma once
 
+#include <anvill/Analysis/CrossReferenceResolver.h>
 #include <anvill/Lifters/EntityLifter.h>
 #include <anvill/Lifters/Options.h>
 #include <anvill/Providers/MemoryProvider.h>
 #include <anvill/Providers/TypeProvider.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/IR/ValueHandle.h>
 
 #include <functional>
 #include <unordered_map>
-#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -58,14 +61,25 @@ class EntityLifterImpl {
   // view of the world remains consistent.
   void AddEntity(llvm::Constant *entity, uint64_t address);
 
-  // Applies a callback `cb` to each entity at a specified address.
-  void ForEachEntityAtAddress(uint64_t address,
-                              std::function<void(llvm::Constant *)> cb) const;
+  // Applies a callback `cb` to each entity at a specified address, in the
+  // order in which the entities were added. `cb` must not add entities.
+  template <typename CB>
+  inline void ForEachEntityAtAddress(uint64_t address, CB &&cb) const {
+    if (auto entities = EntitiesAtAddress(address)) {
+      for (auto entity : *entities) {
+        cb(entity);
+      }
+    }
+  }
 
   // Assuming that `entity` is an entity that was lifted by this `EntityLifter`,
   // then return the address of that entity in the binary being lifted.
   std::optional<uint64_t> AddressOfEntity(llvm::Constant *entity) const;
 
+  // Adds the global values registered by `AddEntity` since the last call to
+  // `llvm.compiler.used`.
+  void MaterializeCompilerUsed(void);
+
  private:
   friend class EntityLifter;
   friend class DataLifter;
@@ -75,6 +89,17 @@ class EntityLifterImpl {
 
   EntityLifterImpl(void) = delete;
 
+  using EntityList = llvm::SmallVector<llvm::Constant *, 2>;
+
+  // Returns `true` if `address` is one of the keys that `DenseMap` reserves.
+  static inline bool IsReservedAddress(uint64_t address) {
+    return address == llvm::DenseMapInfo<uint64_t>::getEmptyKey() ||
+           address == llvm::DenseMapInfo<uint64_t>::getTombstoneKey();
+  }
+
+  // Returns the entities at `address`, or `nullptr` if there are none.
+  const EntityList *EntitiesAtAddress(uint64_t address) const;
+
   // Options used to guide how lifting should occur.
   const LifterOptions &options;
 
@@ -84,6 +109,10 @@ class EntityLifterImpl {
   // Provider of type information when asking for function prototypes.
   const std::shared_ptr<TypeProvider> type_provider;
 
+  // Cache of resolved cross-references, shared by all resolvers created from
+  // this entity lifter.
+  const CrossReferenceCache::Ptr xref_cache;
+
   // Lifts initializers of global variables. Talks with the `data_lifter`
   // and the `function_lifter` when its trying to resolve cross-references
   // embedded in initialziers.
@@ -97,12 +126,26 @@ class EntityLifterImpl {
   DataLifter data_lifter;
 
   // Maps native code addresses to lifted entities. The lifted entities reside
-  // in the `options.module` module.
-  std::unordered_map<uint64_t, std::unordered_set<llvm::Constant *>>
-      address_to_entity;
+  // in the `options.module` module. Almost every address has only one or two
+  // entities, e.g. a variable and an alias to it, so they're stored inline.
+  //
+  // NOTE(pag): `DenseMap` reserves the two largest `uint64_t` values as its
+  //            empty and tombstone keys, so entities at those addresses are
+  //            kept in `reserved_address_to_entity` instead.
+  llvm::DenseMap<uint64_t, EntityList> address_to_entity;
+  std::unordered_map<uint64_t, EntityList> reserved_address_to_entity;
 
   // Maps lifted entities to native addresses. The lifted
-  std::unordered_map<llvm::Constant *, uint64_t> entity_to_address;
+  llvm::DenseMap<llvm::Constant *, uint64_t> entity_to_address;
+
+  // Maps the addresses of lifted functions to the addresses of the functions
+  // that they directly call (or tail-call).
+  std::unordered_map<uint64_t, std::vector<uint64_t>> address_to_callees;
+
+  // Global values registered by `AddEntity` that aren't yet in
+  // `llvm.compiler.used`. Appending to `llvm.compiler.used` rebuilds its whole
+  // initializer, so we batch these up rather than appending one at a time.
+  std::vector<llvm::WeakTrackingVH> pending_compiler_used;
 };
 
 }  // namespace anvill
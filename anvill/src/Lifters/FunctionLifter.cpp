@@ -21,6 +21,7 @@
 #include <anvill/Lifters/DeclLifter.h>
 #include <anvill/Providers/MemoryProvider.h>
 #include <anvill/Providers/TypeProvider.h>
+#include <anvill/Statistics.h>
 #include <anvill/TypePrinter.h>
 #include <gflags/gflags.h>
 #include <glog/logging.h>
@@ -46,6 +47,9 @@
 #include <remill/BC/Version.h>
 #include <remill/OS/OS.h>
 
+#include <algorithm>
+#include <chrono>
+#include <iterator>
 #include <sstream>
 
 #include "EntityLifter.h"
@@ -177,6 +181,15 @@ llvm::BasicBlock *FunctionLifter::GetOrCreateTargetBlock(uint64_t addr) {
 bool FunctionLifter::DecodeInstructionInto(const uint64_t addr, bool is_delayed,
                                            remill::Instruction *inst_out) {
   static const auto max_inst_size = options.arch->MaxInstructionSize();
+
+  // Try to use an instruction that was decoded ahead of time.
+  if (!is_delayed && options.decode_table) {
+    if (auto inst = options.decode_table->Find(addr)) {
+      *inst_out = *inst;
+      return true;
+    }
+  }
+
   inst_out->Reset();
 
   // Read the maximum number of bytes possible for instructions on this
@@ -792,18 +805,17 @@ void FunctionLifter::InstrumentCallBreakpointFunction(llvm::BasicBlock *block) {
 // information to try to improve lifting of possible pointers later on
 // in the optimization process.
 void FunctionLifter::VisitTypedHintedRegister(
-    llvm::BasicBlock *block, const std::string &reg_name, llvm::Type *type,
+    llvm::BasicBlock *block, const remill::Register *reg, llvm::Type *type,
     std::optional<uint64_t> maybe_value) {
 
   // Only operate on pointer-sized integer registers that are not sub-registers.
-  const auto reg = options.arch->RegisterByName(reg_name);
   if (reg->EnclosingRegister() != reg ||
       !reg->type->isIntegerTy(options.arch->address_size)) {
     return;
   }
 
   llvm::IRBuilder irb(block);
-  auto reg_pointer = inst_lifter.LoadRegAddress(block, state_ptr, reg_name);
+  auto reg_pointer = inst_lifter.LoadRegAddress(block, state_ptr, reg->name);
   llvm::Value *reg_value = nullptr;
 
   // If we have a concrete value that is being provided for this value, then
@@ -835,6 +847,48 @@ void FunctionLifter::VisitTypedHintedRegister(
   irb.CreateStore(replacement_reg, reg_pointer);
 }
 
+// Visit all type hinted registers at the current instruction, using either
+// the pre-computed `reg_hints`, or by querying the type provider.
+void FunctionLifter::VisitTypedHintedRegisters(llvm::BasicBlock *block) {
+  const auto pc = curr_inst->pc;
+
+  if (!has_reg_hints) {
+    type_provider.QueryRegisterStateAtInstruction(
+        func_address, pc,
+        [=](const std::string &reg_name, llvm::Type *type,
+            std::optional<uint64_t> maybe_value) {
+          VisitTypedHintedRegister(
+              block, options.arch->RegisterByName(reg_name), type,
+              maybe_value);
+        });
+    return;
+  }
+
+  const auto begin = reg_hints.begin();
+  const auto end = reg_hints.end();
+  auto it = begin + next_reg_hint;
+  auto less = [](const TypedRegisterHints::value_type &hint, uint64_t addr) {
+    return hint.first < addr;
+  };
+
+  // The work list mostly visits instructions in increasing order, so search
+  // forward from the cursor, unless we've gone backward (e.g. the target of
+  // a backward jump).
+  if (it != begin && std::prev(it)->first >= pc) {
+    it = std::lower_bound(begin, it, pc, less);
+  } else {
+    it = std::lower_bound(it, end, pc, less);
+  }
+
+  for (; it != end && it->first == pc; ++it) {
+    const auto &reg_decl = it->second;
+    VisitTypedHintedRegister(block, reg_decl.reg, reg_decl.type,
+                             reg_decl.value);
+  }
+
+  next_reg_hint = static_cast<size_t>(it - begin);
+}
+
 // Visit an instruction, and lift it into a basic block. Then, based off of
 // the category of the instruction, invoke one of the category-specific
 // lifters to enact a change in control-flow.
@@ -886,12 +940,7 @@ void FunctionLifter::VisitInstruction(remill::Instruction &inst,
   // Try to find any register type hints that we can use later to improve
   // pointer lifting.
   if (options.symbolic_register_types) {
-    type_provider.QueryRegisterStateAtInstruction(
-        func_address, inst.pc,
-        [=](const std::string &reg_name, llvm::Type *type,
-            std::optional<uint64_t> maybe_value) {
-          VisitTypedHintedRegister(block, reg_name, type, maybe_value);
-        });
+    VisitTypedHintedRegisters(block);
   }
 
   switch (inst.category) {
@@ -989,6 +1038,29 @@ llvm::Value *FunctionLifter::TryCallNativeFunction(uint64_t native_addr,
   return mem_ptr;
 }
 
+// Returns `true` if lifting the current function has exceeded the decoded
+// instruction or basic block budgets in `options`.
+bool FunctionLifter::ExceedsLiftingBudget(void) const {
+  if (options.max_decoded_instructions &&
+      num_decoded_insts >= options.max_decoded_instructions) {
+    LOG(WARNING) << "Function at " << std::hex << func_address << std::dec
+                 << " exceeds the budget of "
+                 << options.max_decoded_instructions
+                 << " decoded instructions";
+    return true;
+  }
+
+  if (options.max_basic_blocks &&
+      edge_to_dest_block.size() > options.max_basic_blocks) {
+    LOG(WARNING) << "Function at " << std::hex << func_address << std::dec
+                 << " exceeds the budget of " << options.max_basic_blocks
+                 << " basic blocks";
+    return true;
+  }
+
+  return false;
+}
+
 // Visit all instructions. This runs the work list and lifts instructions.
 void FunctionLifter::VisitInstructions(uint64_t address) {
   remill::Instruction inst;
@@ -1049,6 +1121,24 @@ void FunctionLifter::VisitInstructions(uint64_t address) {
       continue;
     }
 
+    // Once we're over budget, cut off every remaining path through the
+    // function with a call to `__remill_error`, or just give up if we'll be
+    // discarding the function body anyway.
+    if (!budget_exceeded && ExceedsLiftingBudget()) {
+      budget_exceeded = true;
+      if (options.lifting_budget_exceeded_action ==
+          LiftingBudgetExceededAction::kDeclareOnly) {
+        return;
+      }
+    }
+
+    if (budget_exceeded) {
+      MuteStateEscape(remill::AddTerminatingTailCall(block, intrinsics.error));
+      continue;
+    }
+
+    ++num_decoded_insts;
+
     // Decode.
     if (!DecodeInstructionInto(inst_addr, false /* is_delayed */, &inst)) {
       LOG(ERROR) << "Could not decode instruction at " << std::hex << inst_addr
@@ -1475,9 +1565,21 @@ llvm::Function *FunctionLifter::LiftFunction(const FunctionDecl &decl) {
   inst_lifter.ClearCache();
   curr_inst = nullptr;
   state_ptr = nullptr;
+  num_decoded_insts = 0;
+  budget_exceeded = false;
   func_address = decl.address;
   native_func = DeclareFunction(decl);
 
+  // Get all of the register type hints for this function up-front, so that
+  // we don't need to go back to the type provider for every instruction.
+  reg_hints.clear();
+  next_reg_hint = 0;
+  has_reg_hints = false;
+  if (options.symbolic_register_types) {
+    has_reg_hints =
+        type_provider.QueryRegisterStatesInFunction(func_address, reg_hints);
+  }
+
   // Not a valid address, or memory isn't executable.
   auto [first_byte, first_byte_avail, first_byte_perms] =
       memory_provider.Query(func_address);
@@ -1548,6 +1650,14 @@ llvm::Function *FunctionLifter::LiftFunction(const FunctionDecl &decl) {
   // Go lift all instructions!
   VisitInstructions(func_address);
 
+  // We went over budget, and we've been asked to leave the function as a
+  // declaration.
+  if (budget_exceeded && options.lifting_budget_exceeded_action ==
+                             LiftingBudgetExceededAction::kDeclareOnly) {
+    lifted_func->deleteBody();
+    return native_func;
+  }
+
   // Fill up `native_func` with a basic block and make it call `lifted_func`.
   // This creates things like the stack-allocated `State` structure.
   CallLiftedFunctionFromNativeFunction();
@@ -1556,6 +1666,17 @@ llvm::Function *FunctionLifter::LiftFunction(const FunctionDecl &decl) {
   // functions into `native_func`.
   RecursivelyInlineLiftedFunctionIntoNativeFunction();
 
+  // Inlining can blow up the function size well past what the decoded
+  // instructions suggested. There's no sensible place to cut off lifting at
+  // this stage, so we fall back to a declaration.
+  if (options.max_ir_instructions &&
+      native_func->getInstructionCount() > options.max_ir_instructions) {
+    LOG(WARNING) << "Function at " << std::hex << func_address << std::dec
+                 << " exceeds the budget of " << options.max_ir_instructions
+                 << " IR instructions; leaving it as a declaration";
+    native_func->deleteBody();
+  }
+
   return native_func;
 }
 
@@ -1607,6 +1728,8 @@ llvm::Function *EntityLifter::LiftEntity(const FunctionDecl &decl) const {
       << " and lifting function with type "
       << remill::LLVMThingToString(module_func_type);
 
+  const auto start_time = std::chrono::steady_clock::now();
+
   // Try to lift the function. If we failed then return the function found
   // with a matching type, if any.
   const auto func = func_lifter.LiftFunction(decl);
@@ -1638,6 +1761,20 @@ llvm::Function *EntityLifter::LiftEntity(const FunctionDecl &decl) const {
     }
   }
 
+  if (auto stats = impl->options.statistics) {
+    FunctionLiftStatistics lift_stats;
+    lift_stats.address = decl.address;
+    lift_stats.function_name = func_in_target_module->getName().str();
+    lift_stats.wall_time_us = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start_time)
+            .count());
+    lift_stats.num_decoded_instructions =
+        func_lifter.NumDecodedInstructions();
+    lift_stats.size = IRSize::Of(*func_in_target_module);
+    stats->RecordFunctionLift(std::move(lift_stats));
+  }
+
   return func_in_target_module;
 }
 
@@ -1782,19 +1919,32 @@ FunctionLifter::AddFunctionToContext(llvm::Function *func, uint64_t address,
   lifter_context.AddEntity(new_version, address);
 
   // The function we just lifted may call other functions, so we need to go
-  // find those and also use them to update the context.
-  for (auto &inst : llvm::instructions(*func)) {
+  // find those and also use them to update the context. We also remember
+  // the direct call edges, so that functions can be processed in callee-first
+  // order.
+  //
+  // NOTE(pag): `func`'s body has been erased by now, so look at the calls in
+  //            `new_version`, which reference the callees in `target_module`.
+  std::vector<uint64_t> callees;
+  for (auto &inst : llvm::instructions(*new_version)) {
     if (auto call = llvm::dyn_cast<llvm::CallBase>(&inst)) {
       if (auto called_func = call->getCalledFunction()) {
         const auto called_func_name = called_func->getName().str();
         auto called_func_addr = AddressOfNamedFunction(called_func_name);
         if (called_func_addr) {
           lifter_context.AddEntity(called_func, *called_func_addr);
+          callees.push_back(*called_func_addr);
         }
       }
     }
   }
 
+  if (!new_version->isDeclaration()) {
+    std::sort(callees.begin(), callees.end());
+    callees.erase(std::unique(callees.begin(), callees.end()), callees.end());
+    lifter_context.address_to_callees[address] = std::move(callees);
+  }
+
   return new_version;
 }
 
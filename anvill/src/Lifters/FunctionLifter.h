@@ -19,6 +19,7 @@
 
 #include <anvill/Decl.h>
 #include <anvill/Lifters/Options.h>
+#include <anvill/Providers/TypeProvider.h>
 #include <llvm/IR/CallingConv.h>
 #include <remill/BC/InstructionLifter.h>
 #include <remill/BC/IntrinsicTable.h>
@@ -45,7 +46,6 @@ namespace anvill {
 
 class EntityLifterImpl;
 class MemoryProvider;
-class TypeProvider;
 
 // Orchestrates lifting of instructions and control-flow between instructions.
 class FunctionLifter {
@@ -68,6 +68,12 @@ class FunctionLifter {
   std::optional<uint64_t>
   AddressOfNamedFunction(const std::string &func_name) const;
 
+  // Returns the number of instructions decoded while lifting the most
+  // recently lifted function.
+  inline unsigned NumDecodedInstructions(void) const {
+    return num_decoded_insts;
+  }
+
   // Update the associated entity lifter with information about this
   // function, and copy the function into the context's module. Returns the
   // version of `func` inside the module of the lifter context.
@@ -116,6 +122,13 @@ class FunctionLifter {
   // Current instruction being lifted.
   remill::Instruction *curr_inst{nullptr};
 
+  // Number of instructions decoded so far in the function being lifted.
+  unsigned num_decoded_insts{0};
+
+  // Did the function being lifted exceed one of the lifting budgets in
+  // `options`?
+  bool budget_exceeded{false};
+
   llvm::Function *log_printf{nullptr};
   llvm::Value *log_format_str{nullptr};
 
@@ -146,6 +159,17 @@ class FunctionLifter {
   // Maps addresses to function declarations, which describe ABIs and such.
   std::unordered_map<uint64_t, FunctionDecl> addr_to_decl;
 
+  // All register type hints for the function being lifted, sorted by
+  // instruction address. This is only used if `has_reg_hints` is `true`,
+  // i.e. if the type provider supports bulk queries.
+  TypedRegisterHints reg_hints;
+  bool has_reg_hints{false};
+
+  // Index into `reg_hints` of the first hint after those of the most recently
+  // visited instruction. Instructions are visited roughly in order, so this
+  // acts as a cursor that usually only needs to move forward.
+  size_t next_reg_hint{0};
+
   // Declare the function decl `decl` and return an `llvm::Function *`. The
   // returned function is a "high-level" function.
   llvm::Function *GetOrDeclareFunction(const FunctionDecl &decl);
@@ -349,9 +373,13 @@ class FunctionLifter {
   // information to try to improve lifting of possible pointers later on
   // in the optimization process.
   void VisitTypedHintedRegister(llvm::BasicBlock *block,
-                                const std::string &reg_name, llvm::Type *type,
+                                const remill::Register *reg, llvm::Type *type,
                                 std::optional<uint64_t> maybe_value);
 
+  // Visit all type hinted registers at the current instruction, using either
+  // the pre-computed `reg_hints`, or by querying the type provider.
+  void VisitTypedHintedRegisters(llvm::BasicBlock *block);
+
   // Visit an instruction, and lift it into a basic block. Then, based off of
   // the category of the instruction, invoke one of the category-specific
   // lifters to enact a change in control-flow.
@@ -370,6 +398,10 @@ class FunctionLifter {
                                      llvm::Function *native_func,
                                      llvm::BasicBlock *block);
 
+  // Returns `true` if lifting the current function has exceeded the decoded
+  // instruction or basic block budgets in `options`.
+  bool ExceedsLiftingBudget(void) const;
+
   // Visit all instructions. This runs the work list and lifts instructions.
   void VisitInstructions(uint64_t address);
 
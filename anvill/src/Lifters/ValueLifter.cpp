@@ -27,8 +27,15 @@
 #include <llvm/IR/DerivedTypes.h>
 #include <llvm/IR/Module.h>
 #include <llvm/IR/Type.h>
+#include <llvm/Support/Host.h>
 #include <remill/BC/Compat/VectorType.h>
 #include <remill/BC/Util.h>
+#include <remill/BC/Version.h>
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
 
 #include "EntityLifter.h"
 
@@ -42,7 +49,7 @@ llvm::APInt ValueLifterImpl::ConsumeBytesAsInt(std::string_view &data,
   llvm::APInt result(num_bytes * 8u, 0u);
   for (auto i = 0u; i < num_bytes; ++i) {
     result <<= 8u;
-    result |= data[i];
+    result |= static_cast<uint8_t>(data[i]);
   }
   data = data.substr(num_bytes);
 
@@ -138,8 +145,114 @@ static llvm::Constant *UnwrapZeroIndices(llvm::Constant *ret,
   return ret;
 }
 
+// Build a `ConstantDataVector` of `num_elms` elements of type `elm_type` from
+// `host_data`, whose elements are already in the host's byte order. `T` is an
+// unsigned integer type of the same size as `elm_type`.
+template <typename T>
+static llvm::Constant *GetDataVector(llvm::Type *elm_type,
+                                     std::string_view host_data,
+                                     unsigned num_elms) {
+  std::vector<T> elms(num_elms);
+  std::memcpy(elms.data(), host_data.data(), num_elms * sizeof(T));
+  if (elm_type->isIntegerTy()) {
+    return llvm::ConstantDataVector::get(elm_type->getContext(), elms);
+  }
+
+#if LLVM_VERSION_NUMBER < LLVM_VERSION(11, 0)
+  return llvm::ConstantDataVector::getFP(elm_type->getContext(), elms);
+#else
+  return llvm::ConstantDataVector::getFP(elm_type, elms);
+#endif
+}
+
 }  // namespace
 
+// Returns `true` if `type` contains no pointers.
+bool ValueLifterImpl::IsPointerFree(llvm::Type *type) {
+  switch (type->getTypeID()) {
+    case llvm::Type::PointerTyID: return false;
+    case llvm::Type::StructTyID:
+      for (auto elm_type : llvm::cast<llvm::StructType>(type)->elements()) {
+        if (!IsPointerFree(elm_type)) {
+          return false;
+        }
+      }
+      return true;
+    case llvm::Type::ArrayTyID:
+      return IsPointerFree(type->getArrayElementType());
+    case llvm::GetFixedVectorTypeId():
+      return IsPointerFree(
+          llvm::cast<llvm::FixedVectorType>(type)->getElementType());
+    default: return true;
+  }
+}
+
+// Try to interpret `data` as the backing bytes of an aggregate of type
+// `type` without lifting each element individually.
+llvm::Constant *ValueLifterImpl::TryLiftRawData(std::string_view data,
+                                                llvm::Type *type) const {
+  const auto size = static_cast<uint64_t>(dl.getTypeAllocSize(type));
+  if (data.size() < size) {
+    return nullptr;
+  }
+
+  data = data.substr(0, size);
+
+  // E.g. `.bss`-like variables, or zero-filled tables.
+  if (std::all_of(data.begin(), data.end(), [](char b) { return !b; }) &&
+      IsPointerFree(type)) {
+    return llvm::ConstantAggregateZero::get(type);
+  }
+
+  llvm::Type *elm_type = nullptr;
+  uint64_t num_elms = 0;
+  if (auto array_type = llvm::dyn_cast<llvm::ArrayType>(type)) {
+    elm_type = array_type->getElementType();
+    num_elms = array_type->getNumElements();
+  } else if (auto vec_type = llvm::dyn_cast<llvm::FixedVectorType>(type)) {
+    elm_type = vec_type->getElementType();
+    num_elms = vec_type->getNumElements();
+  } else {
+    return nullptr;
+  }
+
+  // This covers `i8`, `i16`, `i32`, `i64`, `half`, `float`, and `double`.
+  if (!llvm::ConstantDataSequential::isElementTypeCompatible(elm_type)) {
+    return nullptr;
+  }
+
+  const auto elm_size = static_cast<uint64_t>(dl.getTypeAllocSize(elm_type));
+  if (elm_size * num_elms != size) {
+    return nullptr;
+  }
+
+  // The raw data of a `ConstantDataSequential` is kept in the host's byte
+  // order, so we might need to swap the bytes of each element.
+  std::string swapped_data;
+  if (1u < elm_size && dl.isLittleEndian() != llvm::sys::IsLittleEndianHost) {
+    swapped_data.assign(data.begin(), data.end());
+    for (auto it = swapped_data.begin(); it != swapped_data.end();
+         it += static_cast<std::ptrdiff_t>(elm_size)) {
+      std::reverse(it, it + static_cast<std::ptrdiff_t>(elm_size));
+    }
+    data = swapped_data;
+  }
+
+  if (type->isArrayTy()) {
+    return llvm::ConstantDataArray::getRaw(
+        llvm::StringRef(data.data(), data.size()), num_elms, elm_type);
+  }
+
+  const auto num_vec_elms = static_cast<unsigned>(num_elms);
+  switch (elm_size) {
+    case 1u: return GetDataVector<uint8_t>(elm_type, data, num_vec_elms);
+    case 2u: return GetDataVector<uint16_t>(elm_type, data, num_vec_elms);
+    case 4u: return GetDataVector<uint32_t>(elm_type, data, num_vec_elms);
+    case 8u: return GetDataVector<uint64_t>(elm_type, data, num_vec_elms);
+    default: return nullptr;
+  }
+}
+
 // Lift pointers at `ea`.
 //
 // NOTE(pag): This returns `nullptr` upon failure to find `ea` as an
@@ -292,6 +405,13 @@ llvm::Constant *ValueLifterImpl::Lift(std::string_view data, llvm::Type *type,
                                       EntityLifterImpl &ent_lifter,
                                       uint64_t loc_ea) const {
 
+  // Large primitive arrays, e.g. string tables in `.rodata`, would otherwise
+  // lift into one constant per element.
+  if (type->isAggregateType() || type->isVectorTy()) {
+    if (auto raw_val = TryLiftRawData(data, type)) {
+      return raw_val;
+    }
+  }
 
   switch (type->getTypeID()) {
     case llvm::Type::IntegerTyID: {
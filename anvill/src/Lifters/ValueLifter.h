@@ -79,7 +79,17 @@ class ValueLifterImpl {
                              EntityLifterImpl &ent_lifter,
                              uint64_t loc_ea) const;
 
+  // Returns `true` if `type` contains no pointers, and thus if lifting a value
+  // of type `type` never needs to resolve cross-references.
+  static bool IsPointerFree(llvm::Type *type);
+
  private:
+  // Try to interpret `data` as the backing bytes of an aggregate of type
+  // `type` without lifting each element individually. This succeeds for
+  // all-zero aggregates that contain no pointers, and for arrays and vectors
+  // of integer or floating point elements. Returns `nullptr` otherwise.
+  llvm::Constant *TryLiftRawData(std::string_view data, llvm::Type *type) const;
+
   llvm::Constant *GetFunctionPointer(const FunctionDecl &decl,
                                      EntityLifterImpl &ent_lifter) const;
 
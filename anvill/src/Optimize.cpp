@@ -30,6 +30,7 @@
 #include <llvm/IR/InlineAsm.h>
 #include <llvm/IR/Instruction.h>
 #include <llvm/IR/Instructions.h>
+#include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/LegacyPassManager.h>
 #include <llvm/IR/Module.h>
 #include <llvm/IR/Type.h>
@@ -44,6 +45,14 @@
 #include <remill/BC/Optimizer.h>
 #include <remill/BC/Util.h>
 
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
@@ -52,9 +61,365 @@
 #include "anvill/Program.h"
 #include "anvill/Util.h"
 
+#include <anvill/Analysis/CrossReferenceResolver.h>
+#include <anvill/Lifters/EntityLifter.h>
+#include <anvill/Statistics.h>
 #include <anvill/Transforms.h>
 
 namespace anvill {
+namespace {
+
+// Returns the functions of `module` in callee-first order, as determined by
+// the direct call edges discovered while lifting. This way, callees are
+// finalized before their callers. Functions that don't correspond to any
+// function in `program` come last, in module order.
+static std::vector<llvm::Function *>
+FunctionsInCalleeFirstOrder(const EntityLifter &lifter_context,
+                            const Program &program, llvm::Module &module) {
+  std::unordered_map<uint64_t, llvm::Function *> addr_to_func;
+  for (auto &func : module) {
+    if (!func.isDeclaration()) {
+      if (auto maybe_addr = lifter_context.AddressOfEntity(&func)) {
+        addr_to_func.emplace(*maybe_addr, &func);
+      }
+    }
+  }
+
+  std::vector<llvm::Function *> funcs;
+  std::unordered_set<llvm::Function *> seen;
+
+  program.ForEachFunctionInCalleeFirstOrder(
+      [&](uint64_t addr, std::vector<uint64_t> &callees) {
+        lifter_context.ForEachDirectCallee(
+            addr, [&](uint64_t callee_addr) { callees.push_back(callee_addr); });
+      },
+      [&](const FunctionDecl *decl) {
+        if (auto it = addr_to_func.find(decl->address);
+            it != addr_to_func.end() && seen.insert(it->second).second) {
+          funcs.push_back(it->second);
+        }
+        return true;
+      });
+
+  for (auto &func : module) {
+    if (seen.insert(&func).second) {
+      funcs.push_back(&func);
+    }
+  }
+
+  return funcs;
+}
+
+// State shared by the statistics checkpoints of one pass manager. Pass
+// managers run all of their passes over one function before moving on to
+// the next, so each checkpoint only needs to know about the previous one.
+struct CheckpointState {
+  Statistics *stats{nullptr};
+  std::string phase_name;
+  std::chrono::steady_clock::time_point last_time;
+  IRSize last_size;
+};
+
+// Returns the number of microseconds since `start_time`.
+static uint64_t MicrosecondsSince(std::chrono::steady_clock::time_point start) {
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - start)
+          .count());
+}
+
+// Record the run of `pass_name` that ended at the checkpoint after it, then
+// reset the checkpoint state. An empty `pass_name` only resets the state.
+static void RecordCheckpoint(CheckpointState &state,
+                             const std::string &pass_name,
+                             std::string function_name, IRSize size) {
+  if (!pass_name.empty()) {
+    PassRunStatistics pass_stats;
+    pass_stats.phase_name = state.phase_name;
+    pass_stats.pass_name = pass_name;
+    pass_stats.function_name = std::move(function_name);
+    pass_stats.wall_time_us = MicrosecondsSince(state.last_time);
+    pass_stats.before = state.last_size;
+    pass_stats.after = size;
+    state.stats->RecordPassRun(std::move(pass_stats));
+  }
+
+  // Don't count the cost of the checkpoint itself against the next pass.
+  state.last_size = size;
+  state.last_time = std::chrono::steady_clock::now();
+}
+
+// A function pass that records statistics about the pass that ran just before
+// it. The legacy pass manager has no pass instrumentation callbacks, so
+// `InstrumentedFunctionPassManager` interleaves these with the real passes.
+class FunctionStatisticsCheckpoint final : public llvm::FunctionPass {
+ public:
+  FunctionStatisticsCheckpoint(std::shared_ptr<CheckpointState> state_,
+                               std::string pass_name_)
+      : llvm::FunctionPass(ID),
+        state(std::move(state_)),
+        pass_name(std::move(pass_name_)) {}
+
+  bool runOnFunction(llvm::Function &func) final {
+    RecordCheckpoint(*state, pass_name, func.getName().str(),
+                     IRSize::Of(func));
+    return false;
+  }
+
+  void getAnalysisUsage(llvm::AnalysisUsage &usage) const final {
+    usage.setPreservesAll();
+  }
+
+  llvm::StringRef getPassName(void) const final {
+    return "FunctionStatisticsCheckpoint";
+  }
+
+ private:
+  static char ID;
+  const std::shared_ptr<CheckpointState> state;
+  const std::string pass_name;
+};
+
+char FunctionStatisticsCheckpoint::ID = '\0';
+
+// The module pass equivalent of `FunctionStatisticsCheckpoint`.
+class ModuleStatisticsCheckpoint final : public llvm::ModulePass {
+ public:
+  ModuleStatisticsCheckpoint(std::shared_ptr<CheckpointState> state_,
+                             std::string pass_name_)
+      : llvm::ModulePass(ID),
+        state(std::move(state_)),
+        pass_name(std::move(pass_name_)) {}
+
+  bool runOnModule(llvm::Module &module) final {
+    RecordCheckpoint(*state, pass_name, std::string(), IRSize::Of(module));
+    return false;
+  }
+
+  void getAnalysisUsage(llvm::AnalysisUsage &usage) const final {
+    usage.setPreservesAll();
+  }
+
+  llvm::StringRef getPassName(void) const final {
+    return "ModuleStatisticsCheckpoint";
+  }
+
+ private:
+  static char ID;
+  const std::shared_ptr<CheckpointState> state;
+  const std::string pass_name;
+};
+
+char ModuleStatisticsCheckpoint::ID = '\0';
+
+// Wraps a legacy pass manager, and if there is a statistics sink, follows
+// each added pass with a checkpoint that records statistics about that pass.
+template <typename PassManager, typename Checkpoint>
+class InstrumentedPassManager {
+ public:
+  template <typename... Args>
+  InstrumentedPassManager(Statistics *stats, const char *phase_name,
+                          Args &&...args)
+      : pm(std::forward<Args>(args)...) {
+    if (stats) {
+      state = std::make_shared<CheckpointState>();
+      state->stats = stats;
+      state->phase_name = phase_name;
+      pm.add(new Checkpoint(state, std::string()));
+    }
+  }
+
+  void add(llvm::Pass *pass) {
+    std::string pass_name;
+    if (state) {
+      pass_name = pass->getPassName().str();
+    }
+    pm.add(pass);
+    if (state) {
+      pm.add(new Checkpoint(state, std::move(pass_name)));
+    }
+  }
+
+  PassManager pm;
+
+ private:
+  std::shared_ptr<CheckpointState> state;
+};
+
+using InstrumentedFunctionPassManager =
+    InstrumentedPassManager<llvm::legacy::FunctionPassManager,
+                            FunctionStatisticsCheckpoint>;
+
+using InstrumentedModulePassManager =
+    InstrumentedPassManager<llvm::legacy::PassManager,
+                            ModuleStatisticsCheckpoint>;
+
+// Adds function passes to a pass manager.
+using FunctionPassAdder = std::function<void(
+    InstrumentedFunctionPassManager &, ITransformationErrorManager &)>;
+
+// A named phase of the optimization pipeline.
+struct OptimizationPhase {
+  const char *name;
+
+  // Should this phase be run?
+  bool enabled;
+
+  // Does this phase use the entity lifter? If so, then it can't be run on
+  // copies of functions in other LLVM contexts.
+  bool needs_lifter;
+
+  FunctionPassAdder add_passes;
+};
+
+// Run the function passes of `phase` over each of `funcs`. Returns `true` if
+// any function was changed.
+static bool RunFunctionPasses(llvm::Module &module,
+                              const std::vector<llvm::Function *> &funcs,
+                              ITransformationErrorManager &err_man,
+                              const OptimizationPhase &phase,
+                              Statistics *stats) {
+  InstrumentedFunctionPassManager fpm(stats, phase.name, &module);
+  phase.add_passes(fpm, err_man);
+  fpm.pm.doInitialization();
+  auto changed = false;
+  for (auto func : funcs) {
+    changed |= fpm.pm.run(*func);
+  }
+  fpm.pm.doFinalization();
+  return changed;
+}
+
+// Maximum number of times the thorough optimization profile iterates the
+// cleanup, entity recovery, and stack recovery phases.
+static constexpr unsigned kMaxThoroughIterations = 4u;
+
+// A unit of work for parallel optimization. Each work unit has its own LLVM
+// context, so that it can be optimized independently of other work units.
+struct OptimizationWorkUnit {
+  std::unique_ptr<llvm::LLVMContext> context;
+  std::unique_ptr<llvm::Module> module;
+  ITransformationErrorManager::Ptr err_man;
+
+  // Pairs of original functions, and their copies in `module`.
+  std::vector<std::pair<llvm::Function *, llvm::Function *>> funcs;
+
+  // Total number of instructions in `funcs`, used for load balancing.
+  size_t num_insts{0};
+
+  // Did optimizing this work unit change any function?
+  bool changed{false};
+};
+
+// Run the function passes of `phase` over each of `funcs`, using
+// `num_threads` threads. The functions are partitioned into work units, and
+// copied into per-unit LLVM contexts. Each work unit is then optimized by its
+// own thread, and the optimized functions are copied back into `module`.
+// Returns `true` if any function was changed.
+//
+// NOTE(pag): The passes must not depend on anything that is tied to the
+//            context of `module`, e.g. the entity lifter.
+static bool RunFunctionPassesInParallel(
+    llvm::Module &module, const std::vector<llvm::Function *> &funcs,
+    ITransformationErrorManager &err_man, const OptimizationPhase &phase,
+    Statistics *stats, unsigned num_threads) {
+
+  std::vector<llvm::Function *> defined_funcs;
+  for (auto func : funcs) {
+    if (!func->isDeclaration()) {
+      defined_funcs.push_back(func);
+    }
+  }
+
+  // Balance the work units by assigning the biggest functions first, each
+  // time to the least loaded work unit.
+  std::sort(defined_funcs.begin(), defined_funcs.end(),
+            [](llvm::Function *a, llvm::Function *b) {
+              return a->getInstructionCount() > b->getInstructionCount();
+            });
+
+  std::vector<OptimizationWorkUnit> units(
+      std::min<size_t>(num_threads, defined_funcs.size()));
+  if (units.empty()) {
+    return false;
+  }
+
+  for (auto &unit : units) {
+    unit.context.reset(new llvm::LLVMContext);
+    unit.module.reset(new llvm::Module(module.getName(), *unit.context));
+    unit.module->setDataLayout(module.getDataLayout());
+    unit.module->setTargetTriple(module.getTargetTriple());
+    unit.err_man = ITransformationErrorManager::Create(
+        err_man.CapturesFunctionSnapshots());
+  }
+
+  // Copy each function into the least loaded work unit.
+  for (auto func : defined_funcs) {
+    auto &unit = *std::min_element(
+        units.begin(), units.end(),
+        [](const OptimizationWorkUnit &a, const OptimizationWorkUnit &b) {
+          return a.num_insts < b.num_insts;
+        });
+
+    // Copying an earlier function may have already declared this one as a
+    // callee, in which case we copy into that declaration, rather than
+    // creating a renamed duplicate.
+    auto func_copy = unit.module->getFunction(func->getName());
+    if (func_copy) {
+      func_copy->setLinkage(func->getLinkage());
+    } else {
+      const auto func_type = llvm::dyn_cast<llvm::FunctionType>(
+          remill::RecontextualizeType(func->getFunctionType(), *unit.context));
+      func_copy = llvm::Function::Create(func_type, func->getLinkage(),
+                                         func->getName(), unit.module.get());
+    }
+    remill::CloneFunctionInto(func, func_copy);
+    unit.funcs.emplace_back(func, func_copy);
+    unit.num_insts += func->getInstructionCount();
+  }
+
+  // Optimize the work units. Each thread only touches its own LLVM context.
+  std::vector<std::thread> threads;
+  threads.reserve(units.size());
+  for (auto &unit : units) {
+    threads.emplace_back([&unit, &phase, stats](void) {
+      std::vector<llvm::Function *> unit_funcs;
+      for (auto [func, func_copy] : unit.funcs) {
+        unit_funcs.push_back(func_copy);
+      }
+      unit.changed = RunFunctionPasses(*unit.module, unit_funcs,
+                                       *unit.err_man, phase, stats);
+    });
+  }
+
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  // Copy the optimized functions back into `module`, and collect the errors.
+  auto changed = false;
+  for (auto &unit : units) {
+    changed |= unit.changed;
+    for (auto [func, func_copy] : unit.funcs) {
+      const auto linkage = func->getLinkage();
+      func->deleteBody();
+      remill::CloneFunctionInto(func_copy, func);
+      func->setLinkage(linkage);
+    }
+
+    for (const auto &error : unit.err_man->ErrorList()) {
+      err_man.Insert(error);
+    }
+
+    unit.funcs.clear();
+    unit.module.reset();
+    unit.context.reset();
+  }
+
+  return changed;
+}
+
+}  // namespace
 
 // Optimize a module. This can be a module with semantics code, lifted
 // code, etc.
@@ -71,6 +436,10 @@ void OptimizeModule(const EntityLifter &lifter_context,
     used->eraseFromParent();
   }
 
+  // Make sure that all lifted entities survive the inlining phase's global
+  // dead code elimination.
+  lifter_context.MaterializeCompilerUsed();
+
   LOG(INFO) << "Optimizing module.";
 
   if (auto memory_escape = module.getFunction(kMemoryPointerEscapeFunction)) {
@@ -80,53 +449,156 @@ void OptimizeModule(const EntityLifter &lifter_context,
     memory_escape->eraseFromParent();
   }
 
-  llvm::legacy::PassManager mpm;
-  mpm.add(llvm::createFunctionInliningPass(250));
-  mpm.add(llvm::createGlobalOptimizerPass());
-  mpm.add(llvm::createGlobalDCEPass());
-  mpm.add(llvm::createStripDeadDebugInfoPass());
-  mpm.run(module);
-
-  llvm::legacy::FunctionPassManager fpm(&module);
-  fpm.add(llvm::createDeadCodeEliminationPass());
-  fpm.add(llvm::createConstantPropagationPass());
-  fpm.add(llvm::createSinkingPass());
-  fpm.add(llvm::createNewGVNPass());
-  fpm.add(llvm::createSCCPPass());
-  fpm.add(llvm::createDeadStoreEliminationPass());
-  fpm.add(llvm::createSROAPass());
-  fpm.add(llvm::createEarlyCSEPass(true));
-  fpm.add(llvm::createBitTrackingDCEPass());
-  fpm.add(llvm::createCFGSimplificationPass());
-  fpm.add(llvm::createSinkingPass());
-  fpm.add(llvm::createCFGSimplificationPass());
-  fpm.add(llvm::createInstructionCombiningPass());
-
-  auto error_manager_ptr = ITransformationErrorManager::Create();
+  auto error_manager_ptr =
+      ITransformationErrorManager::Create(options.capture_function_snapshots);
   auto &err_man = *error_manager_ptr.get();
 
-  fpm.add(CreateSinkSelectionsIntoBranchTargets());
-  fpm.add(CreateRemoveUnusedFPClassificationCalls());
-  fpm.add(CreateLowerRemillMemoryAccessIntrinsics());
-  fpm.add(CreateRemoveCompilerBarriers());
-  fpm.add(CreateLowerTypeHintIntrinsics());
-  fpm.add(CreateInstructionFolderPass(err_man));
-  fpm.add(llvm::createDeadCodeEliminationPass());
-  fpm.add(CreateRecoverEntityUseInformation(err_man, lifter_context));
-  fpm.add(CreateSinkSelectionsIntoBranchTargets());
-  fpm.add(CreateRemoveTrivialPhisAndSelects());
-  fpm.add(llvm::createDeadCodeEliminationPass());
-  fpm.add(CreateRecoverStackFrameInformation(err_man, options));
-  fpm.add(llvm::createSROAPass());
-  fpm.add(CreateSplitStackFrameAtReturnAddress(err_man));
-  fpm.add(llvm::createSROAPass());
-  fpm.add(CreateBrightenPointerOperations(1024u));
-
-  fpm.doInitialization();
-  for (auto &func : module) {
-    fpm.run(func);
+  // Inline the lifted functions into each other, and clean up whatever
+  // globals are left unused.
+  if (options.enable_inlining_phase) {
+    LOG(INFO) << "Running optimization phase: inlining";
+    InstrumentedModulePassManager mpm(options.statistics, "inlining");
+    mpm.add(llvm::createFunctionInliningPass(250));
+    mpm.add(llvm::createGlobalOptimizerPass());
+    mpm.add(llvm::createGlobalDCEPass());
+    mpm.add(llvm::createStripDeadDebugInfoPass());
+    mpm.pm.run(module);
+  }
+
+  // The per-function phases of the pipeline. Each phase runs over all
+  // functions with its own pass manager before the next phase starts.
+  const auto profile = options.optimization_profile;
+  const auto is_fast = profile == OptimizationProfile::kFast;
+
+  const OptimizationPhase phases[] = {
+
+      // Generic scalar cleanup, and lowering of Remill and Anvill intrinsics
+      // that get in the way of later analyses.
+      {"cleanup", options.enable_cleanup_phase, false,
+       [=](InstrumentedFunctionPassManager &fpm,
+           ITransformationErrorManager &em) {
+         fpm.add(llvm::createDeadCodeEliminationPass());
+         fpm.add(llvm::createConstantPropagationPass());
+         fpm.add(llvm::createSinkingPass());
+         if (!is_fast) {
+           fpm.add(llvm::createNewGVNPass());
+         }
+         fpm.add(llvm::createSCCPPass());
+         fpm.add(llvm::createDeadStoreEliminationPass());
+         fpm.add(llvm::createSROAPass());
+         fpm.add(llvm::createEarlyCSEPass(true));
+         fpm.add(llvm::createBitTrackingDCEPass());
+         fpm.add(llvm::createCFGSimplificationPass());
+         fpm.add(llvm::createSinkingPass());
+         fpm.add(llvm::createCFGSimplificationPass());
+         fpm.add(llvm::createInstructionCombiningPass());
+
+         fpm.add(CreateSinkSelectionsIntoBranchTargets());
+         fpm.add(CreateRemoveUnusedFPClassificationCalls());
+         fpm.add(CreateLowerRemillMemoryAccessIntrinsics());
+         fpm.add(CreateRemoveCompilerBarriers());
+         fpm.add(CreateLowerTypeHintIntrinsics());
+         fpm.add(CreateInstructionFolderPass(em));
+         fpm.add(llvm::createDeadCodeEliminationPass());
+       }},
+
+      // Recover references to functions and variables. Recovering entities,
+      // sinking selections, and folding instructions feed into each other,
+      // so they're iterated to a fixed point.
+      {"entity_recovery", options.enable_entity_recovery_phase, true,
+       [&](InstrumentedFunctionPassManager &fpm,
+           ITransformationErrorManager &em) {
+         fpm.add(CreateFixedPointPassGroup(
+             {CreateRecoverEntityUseInformation(em, lifter_context),
+              CreateSinkSelectionsIntoBranchTargets(),
+              CreateInstructionFolderPass(em),
+              CreateRemoveTrivialPhisAndSelects()},
+             is_fast ? 1u : options.max_pass_group_iterations));
+         fpm.add(llvm::createDeadCodeEliminationPass());
+       }},
+
+      // Recover stack frames, and brighten integer operations into pointer
+      // operations.
+      {"stack_recovery", options.enable_stack_recovery_phase, false,
+       [&](InstrumentedFunctionPassManager &fpm,
+           ITransformationErrorManager &em) {
+         fpm.add(CreateRecoverStackFrameInformation(em, options));
+         fpm.add(llvm::createSROAPass());
+         if (!is_fast) {
+           fpm.add(CreateSplitStackFrameAtReturnAddress(em));
+           fpm.add(llvm::createSROAPass());
+           fpm.add(CreateBrightenPointerOperations(1024u));
+         }
+       }},
+
+      // Lower Remill's control-flow intrinsics into LLVM control flow.
+      {"remill_control_flow", options.enable_remill_control_flow_phase, true,
+       [&](InstrumentedFunctionPassManager &fpm,
+           ITransformationErrorManager &) {
+         fpm.add(CreateTransformRemillJumpIntrinsics(lifter_context));
+         fpm.add(CreateRemoveRemillFunctionReturns(lifter_context));
+         fpm.add(CreateLowerRemillUndefinedIntrinsics());
+       }},
+  };
+
+  const auto funcs =
+      FunctionsInCalleeFirstOrder(lifter_context, program, module);
+
+  // Run a phase, returning `true` if it changed anything. In parallel mode,
+  // the phases that don't need the entity lifter are run on copies of the
+  // functions, spread across several threads.
+  auto run_phase = [&](const OptimizationPhase &phase) {
+    if (!phase.enabled) {
+      return false;
+    }
+
+    LOG(INFO) << "Running optimization phase: " << phase.name;
+    if (options.num_optimization_threads <= 1u || phase.needs_lifter) {
+      return RunFunctionPasses(module, funcs, err_man, phase,
+                               options.statistics);
+    } else {
+      return RunFunctionPassesInParallel(module, funcs, err_man, phase,
+                                         options.statistics,
+                                         options.num_optimization_threads);
+    }
+  };
+
+  // The thorough profile re-runs the cleanup, entity recovery, and stack
+  // recovery phases until they stop changing anything, as each of them can
+  // expose new opportunities for the others.
+  const auto &last_phase = phases[std::size(phases) - 1u];
+  const auto max_iterations =
+      profile == OptimizationProfile::kThorough ? kMaxThoroughIterations : 1u;
+
+  for (auto i = 0u; i < max_iterations; ++i) {
+    auto changed = false;
+    for (const auto &phase : phases) {
+      if (&phase != &last_phase) {
+        changed |= run_phase(phase);
+      }
+    }
+    if (!changed) {
+      break;
+    }
   }
-  fpm.doFinalization();
+
+  // Lowering Remill's control-flow intrinsics happens once, at the end.
+  run_phase(last_phase);
+
+  // If variables were declared lazily, then now that optimization has removed
+  // whatever it could, go initialize the variables that are still referenced.
+  // Their initializers may in turn declare new variables.
+  if (options.lazy_data_initializers) {
+    const auto num_initialized = lifter_context.MaterializeDataInitializers();
+    LOG(INFO) << "Initialized " << num_initialized
+              << " lazily declared variables";
+    if (auto stats = options.statistics) {
+      stats->RecordCounter("lazy_data_initializers", num_initialized);
+    }
+  }
+
+  // Entity recovery may have lifted or declared new entities.
+  lifter_context.MaterializeCompilerUsed();
 
   // We can extend error handling here to provide more visibility
   // into what has happened
@@ -169,14 +641,14 @@ void OptimizeModule(const EntityLifter &lifter_context,
 
   CHECK(!err_man.HasFatalError());
 
-  fpm.add(CreateTransformRemillJumpIntrinsics(lifter_context));
-  fpm.add(CreateRemoveRemillFunctionReturns(lifter_context));
-  fpm.add(CreateLowerRemillUndefinedIntrinsics());
-  fpm.doInitialization();
-  for (auto &func : module) {
-    fpm.run(func);
+  if (auto stats = options.statistics) {
+    const auto xref_stats = lifter_context.CrossReferenceCache()->Statistics();
+    stats->RecordCounter("xref_cache_hits", xref_stats.num_hits);
+    stats->RecordCounter("xref_cache_misses", xref_stats.num_misses);
+    stats->RecordCounter("xref_cache_invalidations",
+                         xref_stats.num_invalidations);
+    stats->RecordCounter("xref_cache_entries", xref_stats.num_entries);
   }
-  fpm.doFinalization();
 
   // Get rid of all final uses of `__anvill_pc`.
   if (auto anvill_pc = module.getGlobalVariable(::anvill::kSymbolicPCName)) {
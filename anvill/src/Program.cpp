@@ -810,8 +810,8 @@ Program::Impl::FindBytes(uint64_t address, size_t size) {
   const auto base_address = limit_address - mapped_data->size();
   if (base_address <= address && address < limit_address) {
     const auto offset = address - base_address;
-    if (size > mapped_data->size()) {
-      size = mapped_data->size();
+    if (size > (mapped_data->size() - offset)) {
+      size = mapped_data->size() - offset;
     }
     return {&((*mapped_data)[offset]), &((*mapped_meta)[offset]), size};
 
@@ -952,9 +952,9 @@ Program::DeclareFunction(const FunctionDecl &decl, bool force) const {
 void Program::ForEachFunction(
     std::function<bool(const FunctionDecl *)> callback) const {
   if (!impl->funcs_are_sorted) {
-    std::sort(impl->vars.begin(), impl->vars.end(),
-              [](const std::unique_ptr<GlobalVarDecl> &a,
-                 const std::unique_ptr<GlobalVarDecl> &b) {
+    std::sort(impl->funcs.begin(), impl->funcs.end(),
+              [](const std::unique_ptr<FunctionDecl> &a,
+                 const std::unique_ptr<FunctionDecl> &b) {
                 return a->address < b->address;
               });
     impl->funcs_are_sorted = true;
@@ -968,6 +968,111 @@ void Program::ForEachFunction(
   }
 }
 
+// Iterate over all functions in callee-first order. This is an iterative
+// version of Tarjan's strongly connected components algorithm, which
+// naturally emits SCCs in reverse topological order, i.e. callees first.
+void Program::ForEachFunctionInCalleeFirstOrder(
+    std::function<void(uint64_t, std::vector<uint64_t> &)> get_callees,
+    std::function<bool(const FunctionDecl *)> callback) const {
+
+  struct NodeInfo {
+    unsigned index;
+    unsigned low_link;
+    bool on_stack;
+  };
+
+  struct Frame {
+    const FunctionDecl *decl;
+    std::vector<uint64_t> callees;
+    size_t next_callee;
+  };
+
+  std::vector<const FunctionDecl *> roots;
+  ForEachFunction([&](const FunctionDecl *decl) {
+    roots.push_back(decl);
+    return true;
+  });
+
+  std::unordered_map<uint64_t, NodeInfo> nodes;
+  std::vector<const FunctionDecl *> scc_stack;
+  std::vector<const FunctionDecl *> scc;
+  std::vector<Frame> dfs_stack;
+  unsigned next_index = 0u;
+
+  auto visit = [&](const FunctionDecl *decl) {
+    nodes.emplace(decl->address, NodeInfo{next_index, next_index, true});
+    ++next_index;
+    scc_stack.push_back(decl);
+    dfs_stack.push_back(Frame{decl, {}, 0u});
+    get_callees(decl->address, dfs_stack.back().callees);
+  };
+
+  for (auto root : roots) {
+    if (nodes.count(root->address)) {
+      continue;
+    }
+
+    visit(root);
+
+    while (!dfs_stack.empty()) {
+      auto &frame = dfs_stack.back();
+
+      // Go visit the next callee of this function.
+      if (frame.next_callee < frame.callees.size()) {
+        const auto callee_address = frame.callees[frame.next_callee++];
+        const auto callee = impl->FindFunction(callee_address);
+        if (!callee) {
+          continue;
+        }
+
+        if (auto it = nodes.find(callee_address); it == nodes.end()) {
+          visit(callee);  // NOTE(pag): Invalidates `frame`.
+
+        } else if (it->second.on_stack) {
+          auto &info = nodes[frame.decl->address];
+          info.low_link = std::min(info.low_link, it->second.index);
+        }
+        continue;
+      }
+
+      // We've visited all callees of this function.
+      const auto decl = frame.decl;
+      dfs_stack.pop_back();
+
+      auto &info = nodes[decl->address];
+      if (!dfs_stack.empty()) {
+        auto &caller_info = nodes[dfs_stack.back().decl->address];
+        caller_info.low_link = std::min(caller_info.low_link, info.low_link);
+      }
+
+      // `decl` is not the root of a strongly connected component.
+      if (info.low_link != info.index) {
+        continue;
+      }
+
+      scc.clear();
+      const FunctionDecl *member = nullptr;
+      do {
+        member = scc_stack.back();
+        scc_stack.pop_back();
+        nodes[member->address].on_stack = false;
+        scc.push_back(member);
+      } while (member != decl);
+
+      std::sort(scc.begin(), scc.end(),
+                [](const FunctionDecl *a, const FunctionDecl *b) {
+                  return a->address < b->address;
+                });
+
+      for (auto scc_decl : scc) {
+        if (!callback(scc_decl)) {
+          return;
+        }
+      }
+    }
+  }
+}
+
 // Search for a specific function by its address.
 const FunctionDecl *Program::FindFunction(uint64_t address) const {
   return impl->FindFunction(address);
@@ -21,6 +21,19 @@
 namespace anvill {
 namespace {
 
+// Returns the permissions of an available byte.
+static BytePermission PermissionsOf(const Byte &byte) {
+  if (byte.IsWriteable() && byte.IsExecutable()) {
+    return BytePermission::kReadableWritableExecutable;
+  } else if (byte.IsWriteable()) {
+    return BytePermission::kReadableWritable;
+  } else if (byte.IsExecutable()) {
+    return BytePermission::kReadableExecutable;
+  } else {
+    return BytePermission::kReadable;
+  }
+}
+
 // Provider of memory wrapping around an `anvill::Program`.
 class ProgramMemoryProvider final : public MemoryProvider {
  public:
@@ -37,19 +50,46 @@ class ProgramMemoryProvider final : public MemoryProvider {
       return {0, ByteAvailability::kUnknown, BytePermission::kUnknown};
     }
 
-    uint8_t byte_out = byte.ValueOr(0u);
-    auto perm_out = BytePermission::kUnknown;
-    if (byte.IsWriteable() && byte.IsWriteable()) {
-      perm_out = BytePermission::kReadableWritableExecutable;
-    } else if (byte.IsWriteable()) {
-      perm_out = BytePermission::kReadableWritable;
-    } else if (byte.IsExecutable()) {
-      perm_out = BytePermission::kReadableExecutable;
-    } else {
-      perm_out = BytePermission::kReadable;
+    return {byte.ValueOr(0u), ByteAvailability::kAvailable,
+            PermissionsOf(byte)};
+  }
+
+  // Reads whole byte sequences at a time, rather than looking up each byte.
+  uint64_t ReadBytes(uint64_t address, uint64_t size,
+                     std::vector<uint8_t> &bytes) final {
+    bytes.clear();
+    auto first_perms = BytePermission::kUnknown;
+    while (bytes.size() < size) {
+      const auto ea = address + bytes.size();
+      const auto seq = program.FindBytes(ea, size - bytes.size());
+      if (!seq || !seq.Size()) {
+        break;
+      }
+
+      for (size_t i = 0u; i < seq.Size(); ++i) {
+        const auto byte = seq[ea + i];
+        if (!byte) {
+          return bytes.size();
+        }
+        const auto perms = PermissionsOf(byte);
+        if (bytes.empty()) {
+          first_perms = perms;
+        } else if (perms != first_perms) {
+          return bytes.size();
+        }
+        bytes.push_back(byte.ValueOr(0u));
+      }
     }
+    return bytes.size();
+  }
 
-    return {byte_out, ByteAvailability::kAvailable, perm_out};
+  // Looks up the whole mapped range at once.
+  std::pair<uint64_t, uint64_t> RangeContaining(uint64_t address) final {
+    const auto seq = program.FindBytesContaining(address);
+    if (!seq || !seq.Size()) {
+      return {address, address};
+    }
+    return {seq.Address(), seq.Address() + seq.Size()};
   }
 
  private:
@@ -71,6 +111,42 @@ class NullMemoryProvider final : public MemoryProvider {
 
 MemoryProvider::~MemoryProvider(void) {}
 
+// Read up to `size` contiguous bytes starting at `address` into `bytes`.
+uint64_t MemoryProvider::ReadBytes(uint64_t address, uint64_t size,
+                                   std::vector<uint8_t> &bytes) {
+  bytes.clear();
+  if (!size) {
+    return 0u;
+  }
+
+  auto [first_byte, first_byte_avail, first_byte_perms] = Query(address);
+  if (!HasByte(first_byte_avail)) {
+    return 0u;
+  }
+
+  bytes.reserve(size);
+  bytes.push_back(first_byte);
+  for (auto i = 1ull; i < size; ++i) {
+    auto [byte, byte_avail, byte_perms] = Query(address + i);
+    if (!HasByte(byte_avail) || byte_perms != first_byte_perms) {
+      break;
+    }
+    bytes.push_back(byte);
+  }
+  return bytes.size();
+}
+
+// Returns the range of addresses of the contiguous memory containing
+// `address`.
+std::pair<uint64_t, uint64_t>
+MemoryProvider::RangeContaining(uint64_t address) {
+  if (IsValidAddress(std::get<1>(Query(address)))) {
+    return {address, address + 1u};
+  } else {
+    return {address, address};
+  }
+}
+
 // Sources bytes from an `anvill::Program`.
 std::shared_ptr<MemoryProvider>
 MemoryProvider::CreateProgramMemoryProvider(const Program &program) {
@@ -25,6 +25,8 @@
 #include <llvm/IR/Type.h>
 #include <remill/BC/Util.h>
 
+#include <algorithm>
+
 namespace anvill {
 namespace {
 
@@ -52,6 +54,11 @@ class ProgramTypeProvider final : public TypeProvider {
                          std::optional<uint64_t>)>
           typed_reg_cb) final;
 
+  // Try to get the types of all hinted registers in the function beginning at
+  // `func_address`, sorted by instruction address.
+  bool QueryRegisterStatesInFunction(uint64_t func_address,
+                                     TypedRegisterHints &hints) final;
+
  private:
   ProgramTypeProvider(void) = delete;
 
@@ -119,6 +126,30 @@ void ProgramTypeProvider::QueryRegisterStateAtInstruction(
   }
 }
 
+// Try to get the types of all hinted registers in the function beginning at
+// `func_address`, sorted by instruction address.
+bool ProgramTypeProvider::QueryRegisterStatesInFunction(
+    uint64_t func_address, TypedRegisterHints &hints) {
+  auto decl = program.FindFunction(func_address);
+  if (!decl) {
+    return true;
+  }
+
+  const auto old_size = hints.size();
+  for (const auto &[inst_address, reg_decls] : decl->reg_info) {
+    for (const auto &reg_decl : reg_decls) {
+      hints.emplace_back(inst_address, reg_decl);
+    }
+  }
+
+  // NOTE(pag): A stable sort keeps the registers of any one instruction in
+  //            the same order as `QueryRegisterStateAtInstruction` visits them.
+  std::stable_sort(
+      hints.begin() + old_size, hints.end(),
+      [](const auto &a, const auto &b) { return a.first < b.first; });
+  return true;
+}
+
 class NullTypeProvider final : public TypeProvider {
  public:
   NullTypeProvider(llvm::LLVMContext &context_) : TypeProvider(context_) {}
@@ -142,6 +173,11 @@ class NullTypeProvider final : public TypeProvider {
       std::function<void(const std::string &, llvm::Type *,
                          std::optional<uint64_t>)>) final {}
 
+  // There are never any register hints.
+  bool QueryRegisterStatesInFunction(uint64_t, TypedRegisterHints &) final {
+    return true;
+  }
+
  private:
   NullTypeProvider(void) = delete;
 };
@@ -161,6 +197,13 @@ void TypeProvider::QueryRegisterStateAtInstruction(
     std::function<void(const std::string &, llvm::Type *,
                        std::optional<uint64_t>)>) {}
 
+// By default, bulk queries aren't supported, and so the lifter falls back on
+// per-instruction queries via `QueryRegisterStateAtInstruction`.
+bool TypeProvider::QueryRegisterStatesInFunction(uint64_t,
+                                                 TypedRegisterHints &) {
+  return false;
+}
+
 // Sources bytes from an `anvill::Program`.
 std::shared_ptr<TypeProvider>
 TypeProvider::CreateProgramTypeProvider(llvm::LLVMContext &context_,
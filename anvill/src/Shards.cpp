@@ -0,0 +1,294 @@
+/*
+ * Copyright (c) 2021 Trail of Bits, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <anvill/ABI.h>
+#include <anvill/Shards.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/DerivedTypes.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/GlobalAlias.h>
+#include <llvm/IR/GlobalVariable.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Linker/Linker.h>
+
+#include <algorithm>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace anvill {
+namespace {
+
+// Returns a key made up of the kind and address of the lifted entity named
+// `name`, e.g. `sub_401000` for any version of the lifted function at
+// `0x401000`. Entities that are named after symbols have no key, and so are
+// only unified with entities of the same name.
+static std::optional<std::string> EntityKey(llvm::StringRef name) {
+  for (const auto &prefix : {std::string("sub_"), kGlobalVariableNamePrefix,
+                             kGlobalAliasNamePrefix}) {
+    if (!name.startswith(prefix)) {
+      continue;
+    }
+
+    const auto address_str = name.substr(prefix.size()).split('_').first;
+    uint64_t address = 0;
+    if (address_str.empty() || address_str.getAsInteger(16, address)) {
+      return std::nullopt;
+    }
+
+    std::stringstream ss;
+    ss << prefix << std::hex << address;
+    return ss.str();
+  }
+  return std::nullopt;
+}
+
+// Returns `true` if `var` is a definition of state that is private to its
+// module, and so must be shared by all shards after linking.
+static bool IsLocalState(const llvm::GlobalVariable &var) {
+  return var.hasLocalLinkage() && !var.isDeclaration() && !var.isConstant();
+}
+
+// Turn `gv`, a definition in a shard, into a declaration, so that the
+// definition in the destination module is kept.
+static void MakeDeclaration(llvm::GlobalValue *gv) {
+  if (auto func = llvm::dyn_cast<llvm::Function>(gv)) {
+    func->deleteBody();
+
+  } else if (auto var = llvm::dyn_cast<llvm::GlobalVariable>(gv)) {
+    var->setInitializer(nullptr);
+    var->setLinkage(llvm::GlobalValue::ExternalLinkage);
+
+  // Aliases can't be declarations, so replace the alias with a declaration of
+  // the same name.
+  } else if (auto alias = llvm::dyn_cast<llvm::GlobalAlias>(gv)) {
+    const auto module = alias->getParent();
+    const auto type = alias->getValueType();
+    llvm::GlobalValue *decl = nullptr;
+    if (auto func_type = llvm::dyn_cast<llvm::FunctionType>(type)) {
+      decl = llvm::Function::Create(func_type,
+                                    llvm::GlobalValue::ExternalLinkage, "",
+                                    module);
+    } else {
+      decl = new llvm::GlobalVariable(
+          *module, type, false, llvm::GlobalValue::ExternalLinkage, nullptr,
+          "", nullptr, llvm::GlobalValue::NotThreadLocal,
+          alias->getType()->getAddressSpace());
+    }
+    decl->takeName(alias);
+    alias->replaceAllUsesWith(
+        llvm::ConstantExpr::getBitCast(decl, alias->getType()));
+    alias->eraseFromParent();
+  }
+}
+
+// Returns an error if `module` has unnamed local state, which can't be
+// unified across shards.
+static llvm::Error CheckLocalStateIsNamed(const llvm::Module &module) {
+  for (const auto &var : module.globals()) {
+    if (IsLocalState(var) && !var.hasName()) {
+      return llvm::createStringError(
+          std::make_error_code(std::errc::invalid_argument),
+          "Shard '%s' has an unnamed local variable, which can't be unified "
+          "with the same variable in other shards",
+          module.getModuleIdentifier().c_str());
+    }
+  }
+  return llvm::Error::success();
+}
+
+}  // namespace
+
+// Returns `true` if the function at `address` should be lifted.
+bool FunctionSelector::Selects(uint64_t address) const {
+  if (!ranges.empty() &&
+      std::none_of(ranges.begin(), ranges.end(), [=](const auto &range) {
+        return range.first <= address && address < range.second;
+      })) {
+    return false;
+  }
+
+  if (1u < num_shards) {
+    const auto it =
+        std::lower_bound(func_addresses.begin(), func_addresses.end(), address);
+    const auto pos = static_cast<uint64_t>(it - func_addresses.begin());
+    return (pos * num_shards) / func_addresses.size() == shard_index;
+  }
+
+  return true;
+}
+
+class ShardLinkerImpl {
+ public:
+  explicit ShardLinkerImpl(llvm::Module &dest_) : dest(dest_), linker(dest_) {}
+
+  // Give the local state of `dest`, e.g. `__anvill_pc`, `__anvill_sp`, and
+  // `__anvill_reg_*`, external linkage for the duration of linking, so that
+  // the same variables in other shards can be declared and resolve to them,
+  // rather than being duplicated and renamed.
+  void ExposeLocalState(void);
+
+  // Prepare `src` to be linked into `dest`. Lifted entities in `src` are
+  // renamed to match the same entities in `dest`, based on their kinds,
+  // addresses, and types. Definitions of entities and of local state that
+  // `dest` already defines become declarations.
+  llvm::Error UnifyWithDestination(llvm::Module &src);
+
+  llvm::Module &dest;
+  llvm::Linker linker;
+
+  // Names of the local variables of `dest` that were given external linkage.
+  std::unordered_set<std::string> exposed;
+};
+
+void ShardLinkerImpl::ExposeLocalState(void) {
+  for (auto &var : dest.globals()) {
+    if (IsLocalState(var) && var.hasName()) {
+      var.setLinkage(llvm::GlobalValue::ExternalLinkage);
+      exposed.insert(var.getName().str());
+    }
+  }
+}
+
+llvm::Error ShardLinkerImpl::UnifyWithDestination(llvm::Module &src) {
+  if (auto err = CheckLocalStateIsNamed(src)) {
+    return err;
+  }
+
+  std::unordered_map<std::string, std::vector<llvm::GlobalValue *>>
+      dest_entities;
+  for (auto &gv : dest.global_values()) {
+    if (auto key = EntityKey(gv.getName())) {
+      dest_entities[*key].push_back(&gv);
+    }
+  }
+
+  // Returns the value in `dest` that is the same entity as `gv`, if any.
+  auto find_in_dest = [&](llvm::GlobalValue *gv) -> llvm::GlobalValue * {
+    if (auto dest_gv = dest.getNamedValue(gv->getName())) {
+      return dest_gv;
+    }
+
+    // The same entity might have been named differently in different shards.
+    if (auto key = EntityKey(gv->getName())) {
+      if (auto it = dest_entities.find(*key); it != dest_entities.end()) {
+        for (auto dest_gv : it->second) {
+          if (dest_gv->getValueType() == gv->getValueType() &&
+              !src.getNamedValue(dest_gv->getName())) {
+            gv->setName(dest_gv->getName());
+            return dest_gv;
+          }
+        }
+      }
+    }
+    return nullptr;
+  };
+
+  std::vector<llvm::GlobalValue *> src_gvs;
+  for (auto &gv : src.global_values()) {
+    if (gv.hasName()) {
+      src_gvs.push_back(&gv);
+    }
+  }
+
+  for (auto gv : src_gvs) {
+
+    // Local functions and constants are left to be copied, and renamed if
+    // their names clash.
+    if (gv->hasLocalLinkage()) {
+      auto var = llvm::dyn_cast<llvm::GlobalVariable>(gv);
+      if (!var || !IsLocalState(*var)) {
+        continue;
+      }
+
+      const auto dest_var =
+          llvm::dyn_cast_or_null<llvm::GlobalVariable>(find_in_dest(var));
+      if (!dest_var || dest_var->hasLocalLinkage()) {
+        continue;
+      }
+
+      if (dest_var->getValueType() != var->getValueType()) {
+        return llvm::createStringError(
+            std::make_error_code(std::errc::invalid_argument),
+            "Local variable '%s' of shard '%s' has a different type than the "
+            "variable of the same name in other shards",
+            var->getName().str().c_str(), src.getModuleIdentifier().c_str());
+      }
+
+      // Only `dest` declares this variable, so keep the definition from `src`,
+      // and restore its local linkage once linking is done.
+      if (dest_var->isDeclaration()) {
+        var->setLinkage(llvm::GlobalValue::ExternalLinkage);
+        exposed.insert(var->getName().str());
+      } else {
+        MakeDeclaration(var);
+      }
+      continue;
+    }
+
+    // Keep the first definition of each entity, e.g. of variables that are
+    // lifted into every shard.
+    auto dest_gv = find_in_dest(gv);
+    if (dest_gv && !dest_gv->isDeclaration() && !gv->isDeclaration()) {
+      MakeDeclaration(gv);
+    }
+  }
+
+  return llvm::Error::success();
+}
+
+ShardLinker::ShardLinker(llvm::Module &dest) : impl(new ShardLinkerImpl(dest)) {}
+
+ShardLinker::~ShardLinker(void) {}
+
+// Link `src` into the destination module.
+llvm::Error ShardLinker::Link(std::unique_ptr<llvm::Module> src) {
+  if (auto err = CheckLocalStateIsNamed(impl->dest)) {
+    return err;
+  }
+
+  impl->ExposeLocalState();
+  if (auto err = impl->UnifyWithDestination(*src)) {
+    return err;
+  }
+
+  const auto id = src->getModuleIdentifier();
+  if (impl->linker.linkInModule(std::move(src))) {
+    return llvm::createStringError(
+        std::make_error_code(std::errc::invalid_argument),
+        "Unable to link shard '%s'", id.c_str());
+  }
+
+  return llvm::Error::success();
+}
+
+// Restore the local linkage of the variables that were unified while linking.
+void ShardLinker::Finish(void) {
+  for (const auto &name : impl->exposed) {
+    if (auto var = impl->dest.getGlobalVariable(name);
+        var && !var->isDeclaration()) {
+      var->setLinkage(llvm::GlobalValue::InternalLinkage);
+    }
+  }
+  impl->exposed.clear();
+}
+
+}  // namespace anvill
@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2021 Trail of Bits, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <anvill/Statistics.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/FormatVariadic.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <map>
+#include <mutex>
+#include <utility>
+
+namespace anvill {
+
+class StatisticsImpl {
+ public:
+  std::mutex lock;
+  std::vector<PassRunStatistics> pass_runs;
+  std::vector<FunctionLiftStatistics> function_lifts;
+  std::map<std::string, uint64_t> counters;
+};
+
+namespace {
+
+static llvm::json::Object SizeToJSON(const IRSize &size) {
+  return llvm::json::Object{
+      {"instructions", static_cast<int64_t>(size.num_instructions)},
+      {"basic_blocks", static_cast<int64_t>(size.num_basic_blocks)}};
+}
+
+// Per-pass totals, aggregated over all functions.
+struct PassSummary {
+  unsigned num_runs{0};
+  uint64_t wall_time_us{0};
+  int64_t instruction_delta{0};
+  int64_t basic_block_delta{0};
+};
+
+}  // namespace
+
+IRSize IRSize::Of(const llvm::Function &func) {
+  IRSize size;
+  for (const auto &block : func) {
+    size.num_instructions += static_cast<unsigned>(block.size());
+    size.num_basic_blocks += 1u;
+  }
+  return size;
+}
+
+IRSize IRSize::Of(const llvm::Module &module) {
+  IRSize size;
+  for (const auto &func : module) {
+    const auto func_size = Of(func);
+    size.num_instructions += func_size.num_instructions;
+    size.num_basic_blocks += func_size.num_basic_blocks;
+  }
+  return size;
+}
+
+Statistics::Statistics(void) : impl(new StatisticsImpl) {}
+
+Statistics::~Statistics(void) {}
+
+// Record one run of a pass over a function or module.
+void Statistics::RecordPassRun(PassRunStatistics stats) {
+  std::lock_guard<std::mutex> locker(impl->lock);
+  impl->pass_runs.emplace_back(std::move(stats));
+}
+
+// Record the lifting of one function.
+void Statistics::RecordFunctionLift(FunctionLiftStatistics stats) {
+  std::lock_guard<std::mutex> locker(impl->lock);
+  impl->function_lifts.emplace_back(std::move(stats));
+}
+
+// Record the value of a named counter.
+void Statistics::RecordCounter(const std::string &name, uint64_t value) {
+  std::lock_guard<std::mutex> locker(impl->lock);
+  impl->counters[name] = value;
+}
+
+// Print out the statistics as a JSON document.
+void Statistics::PrintJSON(llvm::raw_ostream &os) const {
+  std::lock_guard<std::mutex> locker(impl->lock);
+
+  llvm::json::Array lifts;
+  for (const auto &stats : impl->function_lifts) {
+    lifts.push_back(llvm::json::Object{
+        {"address", static_cast<int64_t>(stats.address)},
+        {"function", stats.function_name},
+        {"wall_time_us", static_cast<int64_t>(stats.wall_time_us)},
+        {"decoded_instructions",
+         static_cast<int64_t>(stats.num_decoded_instructions)},
+        {"size", SizeToJSON(stats.size)}});
+  }
+
+  // Keep the summary in the order in which passes first ran.
+  std::map<std::pair<std::string, std::string>, PassSummary> summaries;
+  std::vector<std::pair<std::string, std::string>> summary_order;
+
+  llvm::json::Array runs;
+  for (const auto &stats : impl->pass_runs) {
+    runs.push_back(llvm::json::Object{
+        {"phase", stats.phase_name},
+        {"pass", stats.pass_name},
+        {"function", stats.function_name},
+        {"wall_time_us", static_cast<int64_t>(stats.wall_time_us)},
+        {"before", SizeToJSON(stats.before)},
+        {"after", SizeToJSON(stats.after)}});
+
+    std::pair<std::string, std::string> key(stats.phase_name,
+                                            stats.pass_name);
+    auto [it, added] = summaries.emplace(key, PassSummary{});
+    if (added) {
+      summary_order.emplace_back(std::move(key));
+    }
+
+    auto &summary = it->second;
+    summary.num_runs += 1u;
+    summary.wall_time_us += stats.wall_time_us;
+    summary.instruction_delta +=
+        static_cast<int64_t>(stats.after.num_instructions) -
+        static_cast<int64_t>(stats.before.num_instructions);
+    summary.basic_block_delta +=
+        static_cast<int64_t>(stats.after.num_basic_blocks) -
+        static_cast<int64_t>(stats.before.num_basic_blocks);
+  }
+
+  llvm::json::Array passes;
+  for (const auto &key : summary_order) {
+    const auto &summary = summaries[key];
+    passes.push_back(llvm::json::Object{
+        {"phase", key.first},
+        {"pass", key.second},
+        {"runs", static_cast<int64_t>(summary.num_runs)},
+        {"wall_time_us", static_cast<int64_t>(summary.wall_time_us)},
+        {"instruction_delta", summary.instruction_delta},
+        {"basic_block_delta", summary.basic_block_delta}});
+  }
+
+  llvm::json::Object counters;
+  for (const auto &[name, value] : impl->counters) {
+    counters[name] = static_cast<int64_t>(value);
+  }
+
+  llvm::json::Value doc(llvm::json::Object{
+      {"counters", std::move(counters)},
+      {"lifted_functions", std::move(lifts)},
+      {"pass_summary", std::move(passes)},
+      {"pass_runs", std::move(runs)}});
+
+  os << llvm::formatv("{0:2}", doc) << '\n';
+}
+
+}  // namespace anvill
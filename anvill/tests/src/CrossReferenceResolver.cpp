@@ -0,0 +1,225 @@
+/*
+ * Copyright (c) 2021 Trail of Bits, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <anvill/ABI.h>
+#include <anvill/Analysis/CrossReferenceResolver.h>
+#include <anvill/Decl.h>
+#include <anvill/Lifters/EntityLifter.h>
+#include <anvill/Lifters/Options.h>
+#include <anvill/Providers/MemoryProvider.h>
+#include <anvill/Providers/TypeProvider.h>
+#include <doctest.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/GlobalVariable.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <remill/Arch/Arch.h>
+#include <remill/Arch/Name.h>
+#include <remill/OS/OS.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace anvill {
+namespace {
+
+static std::unique_ptr<EntityLifter> CreateLifter(const LifterOptions &options,
+                                                  llvm::LLVMContext &context) {
+  return std::make_unique<EntityLifter>(
+      options, MemoryProvider::CreateNullMemoryProvider(),
+      TypeProvider::CreateNullTypeProvider(context));
+}
+
+// Declares a variable named `name` of type `i8` in `module`.
+static llvm::GlobalVariable *DeclareByte(llvm::Module &module,
+                                         const std::string &name) {
+  return new llvm::GlobalVariable(
+      module, llvm::Type::getInt8Ty(module.getContext()), false,
+      llvm::GlobalValue::ExternalLinkage, nullptr, name);
+}
+
+// Returns `ptrtoint (i8* @var to i64) + disp`.
+static llvm::Constant *Displace(llvm::GlobalVariable *var, uint64_t disp) {
+  const auto i64_type = llvm::Type::getInt64Ty(var->getContext());
+  return llvm::ConstantExpr::getAdd(
+      llvm::ConstantExpr::getPtrToInt(var, i64_type),
+      llvm::ConstantInt::get(i64_type, disp));
+}
+
+}  // namespace
+
+TEST_SUITE("CrossReferenceCache") {
+  TEST_CASE("Cached resolutions") {
+    llvm::LLVMContext context;
+    llvm::Module module("CrossReferenceCache", context);
+
+    auto arch = remill::Arch::Build(&context, remill::GetOSName("linux"),
+                                    remill::GetArchName("amd64"));
+    REQUIRE(arch != nullptr);
+
+    LifterOptions options(arch.get(), module, nullptr);
+    auto lifter = CreateLifter(options, context);
+    const auto &cache = lifter->CrossReferenceCache();
+    REQUIRE(cache != nullptr);
+
+    SUBCASE("are shared by the resolvers of a lifter") {
+      const auto pc_rel = Displace(DeclareByte(module, kSymbolicPCName), 16u);
+
+      CrossReferenceResolver resolver(*lifter);
+      const auto xr = resolver.TryResolveReference(pc_rel);
+      REQUIRE(xr);
+      CHECK(xr.references_program_counter);
+      CHECK(xr.u.address == 16u);
+      CHECK(cache->Contains(pc_rel));
+
+      const auto before = cache->Statistics();
+      CrossReferenceResolver other_resolver(*lifter);
+      const auto cached_xr = other_resolver.TryResolveReference(pc_rel);
+      const auto after = cache->Statistics();
+
+      CHECK(after.num_hits == before.num_hits + 1u);
+      CHECK(after.num_misses == before.num_misses);
+      CHECK(after.num_entries == before.num_entries);
+      REQUIRE(cached_xr);
+      CHECK(cached_xr.references_program_counter);
+      CHECK(cached_xr.u.address == xr.u.address);
+    }
+
+    SUBCASE("are dropped when their constant is deleted") {
+      const auto var = DeclareByte(module, "deleted");
+
+      CrossReferenceResolver resolver(*lifter);
+      resolver.TryResolveReference(var);
+      REQUIRE(cache->Contains(var));
+
+      const auto before = cache->Statistics();
+      var->eraseFromParent();
+      const auto after = cache->Statistics();
+
+      CHECK(after.num_entries + 1u == before.num_entries);
+      CHECK(after.num_invalidations == before.num_invalidations + 1u);
+    }
+
+    SUBCASE("are dropped when their constant is replaced") {
+      const auto old_var = DeclareByte(module, "old");
+      const auto new_var = DeclareByte(module, "new");
+
+      // Resolves and caches `@old`, `16`, the `ptrtoint`, and the `add`.
+      CrossReferenceResolver resolver(*lifter);
+      resolver.TryResolveReference(Displace(old_var, 16u));
+      REQUIRE(cache->Contains(old_var));
+
+      // The `ptrtoint` and the `add` are rebuilt around `@new`, and the old
+      // ones are destroyed.
+      const auto before = cache->Statistics();
+      old_var->replaceAllUsesWith(new_var);
+      const auto after = cache->Statistics();
+
+      CHECK(after.num_entries + 2u == before.num_entries);
+      CHECK(after.num_invalidations == before.num_invalidations + 2u);
+      CHECK(cache->Contains(old_var));
+      CHECK(!cache->Contains(new_var));
+    }
+  }
+
+  TEST_CASE("Registering an entity clears stale resolutions") {
+    llvm::LLVMContext context;
+    llvm::Module module("CrossReferenceCache", context);
+
+    auto arch = remill::Arch::Build(&context, remill::GetOSName("linux"),
+                                    remill::GetArchName("amd64"));
+    REQUIRE(arch != nullptr);
+
+    LifterOptions options(arch.get(), module, nullptr);
+
+    GlobalVarDecl decl;
+    decl.type = llvm::Type::getInt32Ty(context);
+    decl.address = 0x1000u;
+
+    // The first lifter creates the variable, which the second lifter doesn't
+    // yet know to be an entity.
+    auto first_lifter = CreateLifter(options, context);
+    auto var = llvm::dyn_cast_or_null<llvm::GlobalVariable>(
+        first_lifter->LiftEntity(decl));
+    REQUIRE(var != nullptr);
+
+    auto lifter = CreateLifter(options, context);
+    const auto &cache = lifter->CrossReferenceCache();
+    CrossReferenceResolver resolver(*lifter);
+
+    const auto before_xr = resolver.TryResolveReference(var);
+    CHECK(!before_xr.references_entity);
+    REQUIRE(cache->Contains(var));
+
+    // Lifting the same variable finds the existing one, and registers it as
+    // an entity, which makes the cached resolution of `var` stale.
+    REQUIRE(lifter->LiftEntity(decl) == var);
+    CHECK(!cache->Contains(var));
+    CHECK(cache->Statistics().num_entries == 0u);
+
+    const auto after_xr = resolver.TryResolveReference(var);
+    REQUIRE(after_xr);
+    CHECK(after_xr.references_entity);
+    CHECK(after_xr.u.address == 0x1000u);
+  }
+}
+
+TEST_SUITE("CrossReferenceResolver") {
+  TEST_CASE("Resolving a very deep constant expression") {
+    llvm::LLVMContext context;
+    llvm::Module module("CrossReferenceResolver", context);
+
+    auto arch = remill::Arch::Build(&context, remill::GetOSName("linux"),
+                                    remill::GetArchName("amd64"));
+    REQUIRE(arch != nullptr);
+
+    LifterOptions options(arch.get(), module, nullptr);
+    auto lifter = CreateLifter(options, context);
+    const auto &cache = lifter->CrossReferenceCache();
+
+    // `(((__anvill_pc + 1) + 1) + ...) + 1`, nested deeper than a recursive
+    // evaluation could handle.
+    constexpr uint64_t kDepth = 50000u;
+    const auto i64_type = llvm::Type::getInt64Ty(context);
+    const auto one = llvm::ConstantInt::get(i64_type, 1u);
+    llvm::Constant *expr = Displace(DeclareByte(module, kSymbolicPCName), 1u);
+    for (auto i = 1u; i < kDepth; ++i) {
+      expr = llvm::ConstantExpr::getAdd(expr, one);
+    }
+
+    CrossReferenceResolver resolver(*lifter);
+    const auto xr = resolver.TryResolveReference(expr);
+    REQUIRE(xr);
+    CHECK(xr.references_program_counter);
+    CHECK(xr.u.address == kDepth);
+
+    // Each sub-expression is cached once: the `add`s, the `ptrtoint`, the
+    // `1`, and `__anvill_pc`.
+    const auto stats = cache->Statistics();
+    CHECK(stats.num_entries == kDepth + 3u);
+
+    // Resolving it again is a single lookup.
+    const auto cached_xr = resolver.TryResolveReference(expr);
+    const auto cached_stats = cache->Statistics();
+    CHECK(cached_stats.num_hits == stats.num_hits + 1u);
+    CHECK(cached_stats.num_misses == stats.num_misses);
+    CHECK(cached_xr.u.address == kDepth);
+  }
+}
+
+}  // namespace anvill
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2021 Trail of Bits, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <anvill/Decl.h>
+#include <anvill/Lifters/EntityLifter.h>
+#include <anvill/Lifters/Options.h>
+#include <anvill/Providers/MemoryProvider.h>
+#include <anvill/Providers/TypeProvider.h>
+#include <doctest.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <remill/Arch/Arch.h>
+#include <remill/Arch/Name.h>
+#include <remill/OS/OS.h>
+
+#include <cstdint>
+
+namespace anvill {
+
+TEST_SUITE("EntityLifter") {
+  TEST_CASE("Entities at the largest addresses") {
+    llvm::LLVMContext context;
+    llvm::Module module("EntityLifter", context);
+
+    auto arch = remill::Arch::Build(&context, remill::GetOSName("linux"),
+                                    remill::GetArchName("amd64"));
+    REQUIRE(arch != nullptr);
+
+    LifterOptions options(arch.get(), module, nullptr);
+    EntityLifter lifter(options, MemoryProvider::CreateNullMemoryProvider(),
+                        TypeProvider::CreateNullTypeProvider(context));
+
+    // The first two are the empty and tombstone keys of a `llvm::DenseMap`
+    // with `uint64_t` keys.
+    for (uint64_t address : {~0ull, ~0ull - 1u, ~0ull - 2u}) {
+      CAPTURE(address);
+
+      GlobalVarDecl decl;
+      decl.type = llvm::Type::getInt32Ty(context);
+      decl.address = address;
+
+      const auto var = lifter.LiftEntity(decl);
+      REQUIRE(var != nullptr);
+      CHECK(lifter.AddressOfEntity(var) == address);
+
+      // Lifting it again doesn't duplicate it.
+      CHECK(lifter.LiftEntity(decl) == var);
+    }
+  }
+}
+
+}  // namespace anvill
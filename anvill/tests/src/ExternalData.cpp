@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2021 Trail of Bits, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <anvill/Decl.h>
+#include <anvill/ExternalData.h>
+#include <anvill/Lifters/EntityLifter.h>
+#include <anvill/Lifters/Options.h>
+#include <anvill/Program.h>
+#include <anvill/Providers/MemoryProvider.h>
+#include <anvill/Providers/TypeProvider.h>
+#include <doctest.h>
+#include <llvm/IR/DerivedTypes.h>
+#include <llvm/IR/GlobalVariable.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/raw_ostream.h>
+#include <remill/Arch/Arch.h>
+#include <remill/Arch/Name.h>
+#include <remill/OS/OS.h>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace anvill {
+namespace {
+
+// Where a variable is expected to be in the blob.
+struct ExpectedEntry {
+  uint64_t address;
+  uint64_t offset;
+  const std::vector<uint8_t> *bytes;
+};
+
+static std::vector<uint8_t> MakeBytes(size_t size, unsigned seed) {
+  std::vector<uint8_t> bytes(size);
+  for (size_t i = 0u; i < size; ++i) {
+    bytes[i] = static_cast<uint8_t>((i * seed + (i >> 8u)) & 0xffu);
+  }
+  return bytes;
+}
+
+}  // namespace
+
+TEST_SUITE("ExternalData") {
+  TEST_CASE("Large initializers round-trip through the blob and manifest") {
+    llvm::LLVMContext context;
+    llvm::Module module("ExternalData", context);
+
+    auto arch = remill::Arch::Build(&context, remill::GetOSName("linux"),
+                                    remill::GetArchName("amd64"));
+    REQUIRE(arch != nullptr);
+
+    // The odd-sized byte array makes the following `i32` array need padding.
+    const auto odd_bytes = MakeBytes(5001u, 3u);
+    const auto int_bytes = MakeBytes(4096u, 5u);
+    const auto big_bytes = MakeBytes(1u << 20u, 7u);
+    const auto small_bytes = MakeBytes(16u, 11u);
+
+    Program program;
+    auto map_range = [&](uint64_t address, const std::vector<uint8_t> &bytes) {
+      ByteRange range;
+      range.address = address;
+      range.begin = bytes.data();
+      range.end = bytes.data() + bytes.size();
+      REQUIRE(!llvm::errorToBool(program.MapRange(range)));
+    };
+    map_range(0x10000u, odd_bytes);
+    map_range(0x20000u, int_bytes);
+    map_range(0x200000u, big_bytes);
+    map_range(0x30000u, small_bytes);
+
+    std::string blob;
+    llvm::raw_string_ostream blob_os(blob);
+    ExternalData external_data(blob_os);
+
+    LifterOptions options(arch.get(), module, nullptr);
+    options.external_data = &external_data;
+    options.external_data_threshold = 1024u;
+
+    EntityLifter lifter(options,
+                        MemoryProvider::CreateProgramMemoryProvider(program),
+                        TypeProvider::CreateNullTypeProvider(context));
+
+    auto lift_var = [&](uint64_t address, llvm::Type *elem_type,
+                        uint64_t num_elems) {
+      GlobalVarDecl decl;
+      decl.type = llvm::ArrayType::get(elem_type, num_elems);
+      decl.address = address;
+      auto var = llvm::dyn_cast_or_null<llvm::GlobalVariable>(
+          lifter.LiftEntity(decl));
+      REQUIRE(var != nullptr);
+      return var;
+    };
+
+    const auto i8_type = llvm::Type::getInt8Ty(context);
+    const auto i32_type = llvm::Type::getInt32Ty(context);
+    const auto odd_var = lift_var(0x10000u, i8_type, odd_bytes.size());
+    const auto int_var = lift_var(0x20000u, i32_type, int_bytes.size() / 4u);
+    const auto big_var = lift_var(0x200000u, i8_type, big_bytes.size());
+    const auto small_var = lift_var(0x30000u, i8_type, small_bytes.size());
+
+    // Only the variables at or above the threshold are left out of the module.
+    CHECK(external_data.Contains(odd_var));
+    CHECK(external_data.Contains(int_var));
+    CHECK(external_data.Contains(big_var));
+    CHECK(!external_data.Contains(small_var));
+    CHECK(!odd_var->hasInitializer());
+    CHECK(!int_var->hasInitializer());
+    CHECK(!big_var->hasInitializer());
+    CHECK(small_var->hasInitializer());
+
+    std::map<std::string, ExpectedEntry> expected;
+    expected.emplace(odd_var->getName().str(),
+                     ExpectedEntry{0x10000u, 0u, &odd_bytes});
+    expected.emplace(int_var->getName().str(),
+                     ExpectedEntry{0x20000u, 5004u, &int_bytes});
+    expected.emplace(big_var->getName().str(),
+                     ExpectedEntry{0x200000u, 9100u, &big_bytes});
+
+    blob_os.flush();
+    REQUIRE(external_data.Size() == 9100u + big_bytes.size());
+    REQUIRE(blob.size() == external_data.Size());
+
+    // The padding before the `i32` array is zeroed.
+    CHECK(blob.substr(5001u, 3u) == std::string(3u, '\0'));
+
+    std::string manifest;
+    llvm::raw_string_ostream manifest_os(manifest);
+    external_data.PrintManifestJSON(manifest_os);
+    manifest_os.flush();
+
+    auto maybe_json = llvm::json::parse(manifest);
+    REQUIRE(!llvm::errorToBool(maybe_json.takeError()));
+    const auto doc = maybe_json->getAsObject();
+    REQUIRE(doc != nullptr);
+    CHECK(doc->getInteger("blob_size") ==
+          static_cast<int64_t>(external_data.Size()));
+
+    const auto vars = doc->getArray("variables");
+    REQUIRE(vars != nullptr);
+    REQUIRE(vars->size() == expected.size());
+
+    for (const auto &var_json : *vars) {
+      const auto var = var_json.getAsObject();
+      REQUIRE(var != nullptr);
+      const auto name = var->getString("name");
+      REQUIRE(name);
+      CAPTURE(name->str());
+
+      auto it = expected.find(name->str());
+      REQUIRE(it != expected.end());
+      const auto &entry = it->second;
+      const auto &bytes = *(entry.bytes);
+
+      CHECK(var->getInteger("address") == static_cast<int64_t>(entry.address));
+      CHECK(var->getInteger("offset") == static_cast<int64_t>(entry.offset));
+      CHECK(var->getInteger("size") == static_cast<int64_t>(bytes.size()));
+      CHECK(blob.compare(entry.offset, bytes.size(),
+                         reinterpret_cast<const char *>(bytes.data()),
+                         bytes.size()) == 0);
+    }
+  }
+}
+
+}  // namespace anvill
@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2021 Trail of Bits, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <anvill/Decl.h>
+#include <anvill/Lifters/EntityLifter.h>
+#include <anvill/Lifters/Options.h>
+#include <anvill/Program.h>
+#include <anvill/Providers/MemoryProvider.h>
+#include <anvill/Providers/TypeProvider.h>
+#include <doctest.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/GlobalVariable.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/Error.h>
+#include <remill/Arch/Arch.h>
+#include <remill/Arch/Name.h>
+#include <remill/OS/OS.h>
+
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+namespace anvill {
+namespace {
+
+static const uint8_t kLowRange[] = {0x01, 0x02, 0x03, 0x04,
+                                    0x05, 0x06, 0x07, 0x08};
+
+static const uint8_t kHighRange[] = {0x11, 0x12, 0x13, 0x14,
+                                     0x15, 0x16, 0x17, 0x18};
+
+static const uint8_t kNextHighRange[] = {0x21, 0x22, 0x23, 0x24,
+                                         0x25, 0x26, 0x27, 0x28};
+
+// Maps `[0x1000, 0x1008)` on its own, and `[0x2000, 0x2010)` as two adjacent
+// ranges with the same permissions.
+static void MapTestRanges(Program &program) {
+  ByteRange low;
+  low.address = 0x1000u;
+  low.begin = &(kLowRange[0]);
+  low.end = &(kLowRange[sizeof(kLowRange)]);
+  REQUIRE(!llvm::errorToBool(program.MapRange(low)));
+
+  ByteRange high;
+  high.address = 0x2000u;
+  high.begin = &(kHighRange[0]);
+  high.end = &(kHighRange[sizeof(kHighRange)]);
+  REQUIRE(!llvm::errorToBool(program.MapRange(high)));
+
+  ByteRange next_high;
+  next_high.address = 0x2008u;
+  next_high.begin = &(kNextHighRange[0]);
+  next_high.end = &(kNextHighRange[sizeof(kNextHighRange)]);
+  REQUIRE(!llvm::errorToBool(program.MapRange(next_high)));
+}
+
+}  // namespace
+
+TEST_SUITE("MemoryProvider") {
+  TEST_CASE("Program byte sequences stop at the end of their mapped range") {
+    Program program;
+    MapTestRanges(program);
+
+    CHECK(program.FindBytes(0x1000u, 8u).Size() == 8u);
+    CHECK(program.FindBytes(0x1004u, 8u).Size() == 4u);
+    CHECK(program.FindBytes(0x1007u, 100u).Size() == 1u);
+    CHECK(program.FindBytes(0x2004u, 8u).Size() == 4u);
+    CHECK(!program.FindBytes(0x1008u, 8u));
+  }
+
+  TEST_CASE("Range reads stop at the first unmapped byte") {
+    Program program;
+    MapTestRanges(program);
+
+    auto memory = MemoryProvider::CreateProgramMemoryProvider(program);
+    std::vector<uint8_t> bytes;
+
+    CHECK(memory->ReadBytes(0x1004u, 8u, bytes) == 4u);
+    CHECK(bytes == std::vector<uint8_t>{0x05, 0x06, 0x07, 0x08});
+
+    CHECK(memory->ReadBytes(0x1008u, 8u, bytes) == 0u);
+    CHECK(bytes.empty());
+
+    // Adjacent ranges with the same permissions read as one.
+    CHECK(memory->ReadBytes(0x2004u, 8u, bytes) == 8u);
+    CHECK(bytes == std::vector<uint8_t>{0x15, 0x16, 0x17, 0x18, 0x21, 0x22,
+                                        0x23, 0x24});
+  }
+
+  TEST_CASE("Byte permissions follow the permissions of their range") {
+    Program program;
+    auto map_range = [&](uint64_t address, bool is_writeable,
+                         bool is_executable) {
+      ByteRange range;
+      range.address = address;
+      range.begin = &(kLowRange[0]);
+      range.end = &(kLowRange[sizeof(kLowRange)]);
+      range.is_writeable = is_writeable;
+      range.is_executable = is_executable;
+      REQUIRE(!llvm::errorToBool(program.MapRange(range)));
+    };
+
+    map_range(0x1000u, false, false);
+    map_range(0x2000u, true, false);
+    map_range(0x3000u, false, true);
+    map_range(0x4000u, true, true);
+
+    auto memory = MemoryProvider::CreateProgramMemoryProvider(program);
+    auto perms_of = [&](uint64_t address) {
+      return std::get<2>(memory->Query(address));
+    };
+
+    CHECK(perms_of(0x1000u) == BytePermission::kReadable);
+    CHECK(perms_of(0x2000u) == BytePermission::kReadableWritable);
+    CHECK(perms_of(0x3000u) == BytePermission::kReadableExecutable);
+    CHECK(perms_of(0x4000u) == BytePermission::kReadableWritableExecutable);
+  }
+
+  TEST_CASE("Variables straddling the end of a mapped range") {
+    llvm::LLVMContext context;
+    llvm::Module module("MemoryProvider", context);
+
+    auto arch = remill::Arch::Build(&context, remill::GetOSName("linux"),
+                                    remill::GetArchName("amd64"));
+    REQUIRE(arch != nullptr);
+
+    Program program;
+    MapTestRanges(program);
+
+    LifterOptions options(arch.get(), module, nullptr);
+    EntityLifter lifter(options,
+                        MemoryProvider::CreateProgramMemoryProvider(program),
+                        TypeProvider::CreateNullTypeProvider(context));
+
+    auto lift_var = [&](uint64_t address) {
+      GlobalVarDecl decl;
+      decl.type = llvm::Type::getInt64Ty(context);
+      decl.address = address;
+      auto var = llvm::dyn_cast_or_null<llvm::GlobalVariable>(
+          lifter.LiftEntity(decl));
+      REQUIRE(var != nullptr);
+      return var;
+    };
+
+    SUBCASE("a variable inside of its range is initialized") {
+      auto var = lift_var(0x1000u);
+      REQUIRE(var->hasInitializer());
+      auto init = llvm::dyn_cast<llvm::ConstantInt>(var->getInitializer());
+      REQUIRE(init != nullptr);
+      CHECK(init->getZExtValue() == 0x0807060504030201ull);
+    }
+
+    SUBCASE("a variable running past the end of its range is not") {
+      auto var = lift_var(0x1004u);
+      CHECK(!var->hasInitializer());
+    }
+
+    SUBCASE("a variable running into an adjacent range is initialized") {
+      auto var = lift_var(0x2004u);
+      REQUIRE(var->hasInitializer());
+      auto init = llvm::dyn_cast<llvm::ConstantInt>(var->getInitializer());
+      REQUIRE(init != nullptr);
+      CHECK(init->getZExtValue() == 0x2423222118171615ull);
+    }
+  }
+}
+
+}  // namespace anvill
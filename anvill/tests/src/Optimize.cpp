@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2021 Trail of Bits, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <anvill/Lifters/EntityLifter.h>
+#include <anvill/Lifters/Options.h>
+#include <anvill/Optimize.h>
+#include <anvill/Program.h>
+#include <anvill/Providers/MemoryProvider.h>
+#include <anvill/Providers/TypeProvider.h>
+#include <doctest.h>
+#include <llvm/AsmParser/Parser.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/SourceMgr.h>
+#include <llvm/Support/raw_ostream.h>
+#include <remill/Arch/Arch.h>
+#include <remill/Arch/Name.h>
+#include <remill/OS/OS.h>
+
+#include <map>
+#include <memory>
+#include <string>
+
+namespace anvill {
+namespace {
+
+// `big` is optimized on its own when there are two threads. `ping` and `pong`
+// call each other, and share the other thread, so copying `ping` declares
+// `pong` before `pong` itself is copied.
+static const char kMutuallyCallingFunctions[] = R"(
+define i64 @big(i64 %x) {
+  %a = add i64 %x, 1
+  %b = mul i64 %a, 3
+  %c = xor i64 %b, %x
+  %d = call i64 @ping(i64 %c)
+  %e = add i64 %d, %b
+  %f = sub i64 %e, %a
+  ret i64 %f
+}
+
+define i64 @ping(i64 %x) {
+  %is_zero = icmp eq i64 %x, 0
+  br i1 %is_zero, label %done, label %recurse
+
+recurse:
+  %y = sub i64 %x, 1
+  %r = call i64 @pong(i64 %y)
+  ret i64 %r
+
+done:
+  ret i64 0
+}
+
+define i64 @pong(i64 %x) {
+  %y = add i64 %x, 0
+  %r = call i64 @ping(i64 %y)
+  ret i64 %r
+}
+)";
+
+// Optimizes the functions in `kMutuallyCallingFunctions` using
+// `num_threads` threads, and returns the IR of each function, by name.
+static std::map<std::string, std::string>
+OptimizeWithThreads(unsigned num_threads) {
+  llvm::LLVMContext context;
+  llvm::SMDiagnostic error;
+  auto module =
+      llvm::parseAssemblyString(kMutuallyCallingFunctions, error, context);
+  REQUIRE(module != nullptr);
+
+  auto arch = remill::Arch::Build(&context, remill::GetOSName("linux"),
+                                  remill::GetArchName("amd64"));
+  REQUIRE(arch != nullptr);
+
+  // Only the cleanup phase is run, as it is run in parallel, and doesn't
+  // need lifted code.
+  LifterOptions options(arch.get(), *module, nullptr);
+  options.num_optimization_threads = num_threads;
+  options.enable_inlining_phase = false;
+  options.enable_entity_recovery_phase = false;
+  options.enable_stack_recovery_phase = false;
+  options.enable_remill_control_flow_phase = false;
+
+  Program program;
+  EntityLifter lifter(options, MemoryProvider::CreateNullMemoryProvider(),
+                      TypeProvider::CreateNullTypeProvider(context));
+
+  OptimizeModule(lifter, arch.get(), program, *module, options);
+
+  std::map<std::string, std::string> funcs;
+  for (auto &func : *module) {
+    std::string ir;
+    llvm::raw_string_ostream os(ir);
+    func.print(os);
+    os.flush();
+    funcs.emplace(func.getName().str(), ir);
+  }
+  return funcs;
+}
+
+}  // namespace
+
+TEST_SUITE("OptimizeModule") {
+  TEST_CASE("Parallel optimization matches serial optimization") {
+    const auto serial_funcs = OptimizeWithThreads(1u);
+    const auto parallel_funcs = OptimizeWithThreads(2u);
+
+    // No function was renamed, e.g. to `pong.1`, by being copied twice.
+    REQUIRE(parallel_funcs.size() == 3u);
+    REQUIRE(parallel_funcs.count("big"));
+    REQUIRE(parallel_funcs.count("ping"));
+    REQUIRE(parallel_funcs.count("pong"));
+
+    for (const auto &[name, ir] : serial_funcs) {
+      CAPTURE(name);
+      auto it = parallel_funcs.find(name);
+      REQUIRE(it != parallel_funcs.end());
+      CHECK(it->second == ir);
+    }
+  }
+}
+
+}  // namespace anvill
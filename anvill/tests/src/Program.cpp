@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2021 Trail of Bits, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <anvill/Decl.h>
+#include <anvill/Program.h>
+#include <doctest.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/Error.h>
+#include <remill/Arch/Arch.h>
+#include <remill/Arch/Name.h>
+#include <remill/BC/Util.h>
+#include <remill/OS/OS.h>
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace anvill {
+namespace {
+
+// The call graph of the test program. `0x4000` calls itself, `0x5000` and
+// `0x6000` call each other, and `0x7000` calls an undeclared function.
+static const std::map<uint64_t, std::vector<uint64_t>> kCallGraph = {
+    {0x1000u, {0x2000u, 0x5000u}}, {0x2000u, {0x3000u}},
+    {0x3000u, {}},                 {0x4000u, {0x4000u, 0x3000u}},
+    {0x5000u, {0x6000u}},          {0x6000u, {0x5000u, 0x3000u}},
+    {0x7000u, {0x8000u}}};
+
+// Declares a function at `address` that takes and returns nothing.
+static void DeclareFunction(Program &program, const remill::Arch *arch,
+                            uint64_t address) {
+  const auto sp_reg = arch->RegisterByName(arch->StackPointerRegisterName());
+  REQUIRE(sp_reg != nullptr);
+
+  FunctionDecl decl;
+  decl.arch = arch;
+  decl.address = address;
+  decl.return_address.mem_reg = sp_reg;
+  decl.return_stack_pointer = sp_reg;
+  decl.return_stack_pointer_offset = 8;
+  REQUIRE(!llvm::errorToBool(program.DeclareFunction(decl).takeError()));
+}
+
+}  // namespace
+
+TEST_SUITE("Program") {
+  TEST_CASE("Functions are visited in callee-first order") {
+    llvm::LLVMContext context;
+    auto arch = remill::Arch::Build(&context, remill::GetOSName("linux"),
+                                    remill::GetArchName("amd64"));
+    REQUIRE(arch != nullptr);
+    std::unique_ptr<llvm::Module> semantics(
+        remill::LoadArchSemantics(arch.get()));
+    REQUIRE(semantics != nullptr);
+
+    Program program;
+    for (const auto &[address, callees] : kCallGraph) {
+      DeclareFunction(program, arch.get(), address);
+    }
+
+    auto get_callees = [](uint64_t address, std::vector<uint64_t> &callees) {
+      callees = kCallGraph.at(address);
+    };
+
+    std::vector<uint64_t> order;
+    program.ForEachFunctionInCalleeFirstOrder(
+        get_callees, [&](const FunctionDecl *decl) {
+          order.push_back(decl->address);
+          return true;
+        });
+
+    // Every declared function is visited once.
+    REQUIRE(order.size() == kCallGraph.size());
+    std::map<uint64_t, size_t> position;
+    for (size_t i = 0u; i < order.size(); ++i) {
+      CAPTURE(order[i]);
+      CHECK(position.emplace(order[i], i).second);
+    }
+
+    // The mutually recursive pair is visited as a group, in order of address.
+    CHECK(position[0x6000u] == position[0x5000u] + 1u);
+
+    // Callees are visited before their callers, unless they're in the same
+    // strongly connected component.
+    for (const auto &[caller, callees] : kCallGraph) {
+      for (auto callee : callees) {
+        CAPTURE(caller);
+        CAPTURE(callee);
+        const auto same_scc =
+            caller == callee || (caller == 0x5000u && callee == 0x6000u) ||
+            (caller == 0x6000u && callee == 0x5000u);
+        if (!same_scc && position.count(callee)) {
+          CHECK(position[callee] < position[caller]);
+        }
+      }
+    }
+
+    // The chain `0x1000 -> 0x2000 -> 0x3000` is visited from the end.
+    CHECK(position[0x3000u] < position[0x2000u]);
+    CHECK(position[0x2000u] < position[0x1000u]);
+
+    // Iteration stops when the callback returns `false`.
+    std::vector<uint64_t> first;
+    program.ForEachFunctionInCalleeFirstOrder(
+        get_callees, [&](const FunctionDecl *decl) {
+          first.push_back(decl->address);
+          return false;
+        });
+    CHECK(first == std::vector<uint64_t>{order.front()});
+  }
+}
+
+}  // namespace anvill
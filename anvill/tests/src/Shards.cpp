@@ -0,0 +1,234 @@
+/*
+ * Copyright (c) 2021 Trail of Bits, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <anvill/Shards.h>
+#include <doctest.h>
+#include <llvm/AsmParser/Parser.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/GlobalVariable.h>
+#include <llvm/IR/Instruction.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Verifier.h>
+#include <llvm/Support/SourceMgr.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace anvill {
+namespace {
+
+// The first shard lifts `sub_2000`, and the second shard lifts `sub_3000`.
+// Both lift `data_1000`, which the second shard names differently, and both
+// have their own copies of the symbolic `__anvill_pc` and of `counter`.
+static const char kFirstShard[] = R"(
+@__anvill_pc = internal global i8 0
+@counter = internal global i32 0
+@data_1000 = global i32 1
+
+define i32 @sub_2000() {
+  %c = load i32, i32* @counter
+  %d = load i32, i32* @data_1000
+  %s = add i32 %c, %d
+  store i32 %s, i32* @counter
+  %pc = ptrtoint i8* @__anvill_pc to i32
+  %r = add i32 %s, %pc
+  ret i32 %r
+}
+
+declare i32 @sub_3000()
+)";
+
+static const char kSecondShard[] = R"(
+@__anvill_pc = internal global i8 0
+@counter = internal global i32 0
+@data_1000_i32 = global i32 1
+
+declare i32 @sub_2000()
+
+define i32 @sub_3000() {
+  %c = load i32, i32* @counter
+  %d = load i32, i32* @data_1000_i32
+  %x = call i32 @sub_2000()
+  %s = add i32 %c, %x
+  store i32 %s, i32* @counter
+  %pc = ptrtoint i8* @__anvill_pc to i32
+  %r = add i32 %d, %pc
+  ret i32 %r
+}
+)";
+
+// `counter` has a different type than in `kFirstShard`.
+static const char kConflictingShard[] = R"(
+@counter = internal global i64 0
+
+define i64 @sub_3000() {
+  %c = load i64, i64* @counter
+  ret i64 %c
+}
+)";
+
+// The local variable can't be matched to anything in `kFirstShard`.
+static const char kUnnamedStateShard[] = R"(
+@0 = internal global i32 0
+
+define i32 @sub_3000() {
+  %c = load i32, i32* @0
+  ret i32 %c
+}
+)";
+
+static std::unique_ptr<llvm::Module> ParseShard(const char *ir,
+                                                llvm::LLVMContext &context) {
+  llvm::SMDiagnostic error;
+  auto module = llvm::parseAssemblyString(ir, error, context);
+  REQUIRE(module != nullptr);
+  return module;
+}
+
+// Returns the names of the functions that use `val`.
+static std::set<std::string> UsingFunctions(llvm::Value *val) {
+  std::set<std::string> names;
+  for (auto user : val->users()) {
+    if (auto inst = llvm::dyn_cast<llvm::Instruction>(user)) {
+      names.insert(inst->getFunction()->getName().str());
+    }
+  }
+  return names;
+}
+
+}  // namespace
+
+TEST_SUITE("ShardLinker") {
+  TEST_CASE("Definitions are deduplicated and local state is shared") {
+    llvm::LLVMContext context;
+    auto dest = ParseShard(kFirstShard, context);
+
+    ShardLinker linker(*dest);
+    REQUIRE(!llvm::errorToBool(linker.Link(ParseShard(kSecondShard, context))));
+    linker.Finish();
+
+    CHECK(!llvm::verifyModule(*dest, &llvm::errs()));
+
+    for (auto name : {"sub_2000", "sub_3000"}) {
+      CAPTURE(name);
+      auto func = dest->getFunction(name);
+      REQUIRE(func != nullptr);
+      CHECK(!func->isDeclaration());
+    }
+
+    // Nothing was duplicated and renamed, e.g. to `__anvill_pc.1`.
+    CHECK(dest->global_size() == 3u);
+
+    auto data = dest->getGlobalVariable("data_1000");
+    REQUIRE(data != nullptr);
+    CHECK(data->hasInitializer());
+    CHECK(UsingFunctions(data) ==
+          std::set<std::string>{"sub_2000", "sub_3000"});
+
+    // The local state is back to being local, and is used by both shards.
+    for (auto name : {"__anvill_pc", "counter"}) {
+      CAPTURE(name);
+      auto var = dest->getGlobalVariable(name, true);
+      REQUIRE(var != nullptr);
+      CHECK(var->hasInternalLinkage());
+      CHECK(var->hasInitializer());
+      CHECK(UsingFunctions(var) ==
+            std::set<std::string>{"sub_2000", "sub_3000"});
+    }
+  }
+
+  TEST_CASE("Local state that can't be unified is rejected") {
+    llvm::LLVMContext context;
+    auto dest = ParseShard(kFirstShard, context);
+    ShardLinker linker(*dest);
+
+    SUBCASE("Different types") {
+      CHECK(llvm::errorToBool(
+          linker.Link(ParseShard(kConflictingShard, context))));
+    }
+
+    SUBCASE("Unnamed variable") {
+      CHECK(llvm::errorToBool(
+          linker.Link(ParseShard(kUnnamedStateShard, context))));
+    }
+  }
+}
+
+TEST_SUITE("FunctionSelector") {
+  TEST_CASE("Shards partition the functions into contiguous runs") {
+    FunctionSelector selector;
+    for (uint64_t i = 0u; i < 10u; ++i) {
+      selector.func_addresses.push_back(0x1000u + i * 0x10u);
+    }
+
+    selector.num_shards = 3u;
+    REQUIRE(selector.IsEnabled());
+
+    std::vector<unsigned> shard_of;
+    std::vector<unsigned> shard_sizes(selector.num_shards);
+    for (auto address : selector.func_addresses) {
+      CAPTURE(address);
+      unsigned num_selecting = 0u;
+      for (auto i = 0u; i < selector.num_shards; ++i) {
+        selector.shard_index = i;
+        if (selector.Selects(address)) {
+          ++num_selecting;
+          shard_of.push_back(i);
+          ++shard_sizes[i];
+        }
+      }
+
+      // Every function is lifted by exactly one shard.
+      REQUIRE(num_selecting == 1u);
+    }
+
+    // Each shard lifts a run of neighbouring functions, and the runs are
+    // (nearly) the same length.
+    CHECK(std::is_sorted(shard_of.begin(), shard_of.end()));
+    CHECK(shard_sizes == std::vector<unsigned>{4u, 3u, 3u});
+  }
+
+  TEST_CASE("Address ranges restrict the selected functions") {
+    FunctionSelector selector;
+    for (uint64_t i = 0u; i < 4u; ++i) {
+      selector.func_addresses.push_back(0x1000u + i * 0x10u);
+    }
+    selector.ranges.emplace_back(0x1010u, 0x1030u);
+    REQUIRE(selector.IsEnabled());
+
+    CHECK(!selector.Selects(0x1000u));
+    CHECK(selector.Selects(0x1010u));
+    CHECK(selector.Selects(0x1020u));
+    CHECK(!selector.Selects(0x1030u));
+
+    // Ranges and shards combine; the second half of the functions is only
+    // the one at `0x1020` once restricted to the range.
+    selector.num_shards = 2u;
+    selector.shard_index = 1u;
+    CHECK(!selector.Selects(0x1010u));
+    CHECK(selector.Selects(0x1020u));
+    CHECK(!selector.Selects(0x1030u));
+  }
+}
+
+}  // namespace anvill
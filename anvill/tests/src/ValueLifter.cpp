@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2021 Trail of Bits, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Lifters/ValueLifter.h"
+
+#include <anvill/Lifters/EntityLifter.h>
+#include <anvill/Lifters/Options.h>
+#include <anvill/Lifters/ValueLifter.h>
+#include <anvill/Providers/MemoryProvider.h>
+#include <anvill/Providers/TypeProvider.h>
+#include <doctest.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/DataLayout.h>
+#include <llvm/IR/DerivedTypes.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <remill/Arch/Arch.h>
+#include <remill/Arch/Name.h>
+#include <remill/BC/Compat/VectorType.h>
+#include <remill/OS/OS.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace anvill {
+namespace {
+
+// Encodes `vals` the way that they would appear in the memory of a program
+// with the byte order of `dl`.
+static std::string EncodeElements(const llvm::DataLayout &dl,
+                                  const std::vector<uint32_t> &vals) {
+  std::string data;
+  for (auto val : vals) {
+    for (auto i = 0u; i < 4u; ++i) {
+      const auto shift = dl.isLittleEndian() ? (i * 8u) : ((3u - i) * 8u);
+      data.push_back(static_cast<char>((val >> shift) & 0xffu));
+    }
+  }
+  return data;
+}
+
+// Lifts each element of a value of type `type` from `data` on its own, which
+// bypasses the raw data path for the value as a whole.
+static llvm::Constant *LiftElementWise(const ValueLifter &value_lifter,
+                                       const llvm::DataLayout &dl,
+                                       std::string_view data,
+                                       llvm::Type *type) {
+  std::vector<llvm::Constant *> elms;
+  if (auto struct_type = llvm::dyn_cast<llvm::StructType>(type)) {
+    const auto layout = dl.getStructLayout(struct_type);
+    for (auto i = 0u; i < struct_type->getNumElements(); ++i) {
+      const auto elm_type = struct_type->getElementType(i);
+      elms.push_back(value_lifter.Lift(
+          data.substr(layout->getElementOffset(i)), elm_type));
+    }
+    return llvm::ConstantStruct::get(struct_type, elms);
+  }
+
+  llvm::Type *elm_type = nullptr;
+  uint64_t num_elms = 0;
+  if (auto array_type = llvm::dyn_cast<llvm::ArrayType>(type)) {
+    elm_type = array_type->getElementType();
+    num_elms = array_type->getNumElements();
+  } else {
+    auto vec_type = llvm::cast<llvm::FixedVectorType>(type);
+    elm_type = vec_type->getElementType();
+    num_elms = vec_type->getNumElements();
+  }
+
+  const auto elm_size = static_cast<uint64_t>(dl.getTypeAllocSize(elm_type));
+  for (auto i = 0u; i < num_elms; ++i) {
+    elms.push_back(value_lifter.Lift(data.substr(i * elm_size), elm_type));
+  }
+
+  if (auto array_type = llvm::dyn_cast<llvm::ArrayType>(type)) {
+    return llvm::ConstantArray::get(array_type, elms);
+  } else {
+    return llvm::ConstantVector::get(elms);
+  }
+}
+
+}  // namespace
+
+TEST_SUITE("ValueLifter") {
+  TEST_CASE("Raw data lifts to the same constants as element-wise lifting") {
+
+    // One little endian and one big endian architecture, so that the bytes
+    // of the raw data need swapping on any host.
+    const char *const kArchNames[] = {"amd64", "sparc32"};
+
+    for (auto arch_name : kArchNames) {
+      CAPTURE(arch_name);
+
+      llvm::LLVMContext context;
+      llvm::Module module("ValueLifter", context);
+
+      auto arch = remill::Arch::Build(&context, remill::GetOSName("linux"),
+                                      remill::GetArchName(arch_name));
+      REQUIRE(arch != nullptr);
+
+      LifterOptions options(arch.get(), module, nullptr);
+      EntityLifter entity_lifter(options,
+                                 MemoryProvider::CreateNullMemoryProvider(),
+                                 TypeProvider::CreateNullTypeProvider(context));
+      ValueLifter value_lifter(entity_lifter);
+
+      const auto &dl = module.getDataLayout();
+      const auto i8_ptr_type = llvm::Type::getInt8PtrTy(context);
+      const auto i32_type = llvm::Type::getInt32Ty(context);
+      const auto i64_type = llvm::Type::getInt64Ty(context);
+      const auto float_type = llvm::Type::getFloatTy(context);
+
+      SUBCASE("an array of integers with their high bits set") {
+        const std::vector<uint32_t> vals = {0x7fff0180u, 0x98badcfeu,
+                                            0x80000000u, 0xffffffffu};
+        const auto data = EncodeElements(dl, vals);
+        const auto type = llvm::ArrayType::get(i32_type, vals.size());
+
+        auto raw = value_lifter.Lift(data, type);
+        REQUIRE(raw != nullptr);
+        CHECK(raw == LiftElementWise(value_lifter, dl, data, type));
+
+        auto raw_array = llvm::dyn_cast<llvm::ConstantDataArray>(raw);
+        REQUIRE(raw_array != nullptr);
+        for (auto i = 0u; i < vals.size(); ++i) {
+          CHECK(raw_array->getElementAsInteger(i) == vals[i]);
+        }
+      }
+
+      SUBCASE("a vector of floats") {
+        const std::vector<float> floats = {1.0f, -2.5f, 0.0f, 3.25f};
+        std::vector<uint32_t> vals(floats.size());
+        std::memcpy(vals.data(), floats.data(), floats.size() * 4u);
+
+        const auto data = EncodeElements(dl, vals);
+        const auto type = llvm::FixedVectorType::get(float_type, 4u);
+
+        auto raw = value_lifter.Lift(data, type);
+        REQUIRE(raw != nullptr);
+        CHECK(raw == LiftElementWise(value_lifter, dl, data, type));
+
+        // Not a bitcast of a vector of integers.
+        auto raw_vec = llvm::dyn_cast<llvm::ConstantDataVector>(raw);
+        REQUIRE(raw_vec != nullptr);
+        CHECK(raw_vec->getType() == type);
+        for (auto i = 0u; i < floats.size(); ++i) {
+          CHECK(raw_vec->getElementAsFloat(i) == floats[i]);
+        }
+      }
+
+      SUBCASE("an all-zero structure without pointers") {
+        const auto type = llvm::StructType::get(context, {i32_type, i64_type});
+        const std::string data(dl.getTypeAllocSize(type), '\0');
+
+        CHECK(ValueLifterImpl::IsPointerFree(type));
+
+        auto raw = value_lifter.Lift(data, type);
+        REQUIRE(raw != nullptr);
+        CHECK(llvm::isa<llvm::ConstantAggregateZero>(raw));
+        CHECK(raw == LiftElementWise(value_lifter, dl, data, type));
+      }
+
+      SUBCASE("an all-zero structure with a pointer") {
+        const auto type =
+            llvm::StructType::get(context, {i32_type, i8_ptr_type});
+        const std::string data(dl.getTypeAllocSize(type), '\0');
+
+        // The pointer could be a cross-reference, so it must be lifted on its
+        // own rather than being assumed to be null.
+        CHECK(!ValueLifterImpl::IsPointerFree(type));
+        CHECK(!ValueLifterImpl::IsPointerFree(
+            llvm::ArrayType::get(type, 2u)));
+
+        auto raw = value_lifter.Lift(data, type);
+        REQUIRE(raw != nullptr);
+        CHECK(raw == LiftElementWise(value_lifter, dl, data, type));
+      }
+    }
+  }
+}
+
+}  // namespace anvill
@@ -5,6 +5,8 @@ set(llvm_component_list
   ScalarOpts
   IRReader
   BitWriter
+  Linker
+  TransformUtils
 )
 
 llvm_map_components_to_libnames(llvm_library_list
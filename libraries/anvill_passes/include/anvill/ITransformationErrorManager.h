@@ -59,7 +59,8 @@ struct TransformationError final {
   // name of the function that was being transformed
   std::optional<std::string> function_name;
 
-  // The module IR, before the pass took place
+  // The module IR, before the pass took place. Only available if
+  // the error manager captures function snapshots
   std::optional<std::string> func_before;
 
   // The module IR, after the transformation pass has been
@@ -73,7 +74,13 @@ struct TransformationError final {
 class ITransformationErrorManager {
  public:
   using Ptr = std::unique_ptr<ITransformationErrorManager>;
-  static Ptr Create(void);
+
+  // Creates a new error manager. If `capture_function_snapshots` is
+  // true, then function passes print out the IR of every function
+  // before transforming it, so that errors can report the IR from
+  // both before and after the transformation. This is expensive, and
+  // so it is disabled by default
+  static Ptr Create(bool capture_function_snapshots = false);
 
   ITransformationErrorManager(void) = default;
   virtual ~ITransformationErrorManager(void) = default;
@@ -91,6 +98,10 @@ class ITransformationErrorManager {
 
   // Returns a list of all the stored errors
   virtual const std::vector<TransformationError> &ErrorList(void) const = 0;
+
+  // Returns true if function passes should capture the IR of each
+  // function before transforming it
+  virtual bool CapturesFunctionSnapshots(void) const = 0;
 };
 
 }  // namespace anvill
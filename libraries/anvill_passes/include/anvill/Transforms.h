@@ -22,6 +22,8 @@
 #include <anvill/Lifters/Options.h>
 #include <anvill/Lifters/ValueLifter.h>
 
+#include <vector>
+
 namespace llvm {
 class Function;
 class FunctionPass;
@@ -174,7 +176,9 @@ CreateRemoveRemillFunctionReturns(const EntityLifter &lifter);
 // baseline scalar replacement of aggregates (SROA), and if that pass fails
 // to eliminate the stack frame, then to enable splitting of the stack from
 // into components (see `CreateSplitStackFrameAtReturnAddress`) such that
-// SROA can apply to the arguments and return address components.
+// SROA can apply to the arguments and return address components. If
+// `partition_stack_frames` is set in `options`, then frames that are accessed
+// as several disjoint regions instead get one allocation per region.
 llvm::FunctionPass *
 CreateRecoverStackFrameInformation(ITransformationErrorManager &error_manager,
                                    const LifterOptions &options);
@@ -222,6 +226,22 @@ CreateInstructionFolderPass(ITransformationErrorManager &error_manager);
 // and PHI nodes, followed by the select sinking pass, which pushes values down.
 llvm::FunctionPass *CreateRemoveTrivialPhisAndSelects(void);
 
+// Some of our passes expose new opportunities for each other, e.g. folding
+// instructions through PHI nodes may leave behind trivial PHI nodes, or new
+// references to entities. This pass runs the function passes in `passes`
+// over each function, in order, and keeps re-running them until none of them
+// changes the function, or until `max_iterations` rounds have run. A pass is
+// only re-run if some other pass changed the function since it last ran.
+//
+// The returned pass takes ownership of `passes`.
+//
+// NOTE(pag): The grouped passes are run directly, and not by a pass manager,
+//            and so they must not depend on any analyses, i.e. they must not
+//            call `getAnalysis`. This is true of all of our passes.
+llvm::FunctionPass *
+CreateFixedPointPassGroup(std::vector<llvm::FunctionPass *> passes,
+                          unsigned max_iterations = 4u);
+
 
 // The pass transforms bitcode to replace the calls to `__remill_jump` into
 // `__remill_function_return` if a value returned by `llvm.returnaddress`, or
@@ -19,6 +19,7 @@
 
 
 #include <anvill/ABI.h>
+#include <anvill/Analysis/StackPointerResolver.h>
 #include <anvill/Analysis/Utils.h>
 #include <anvill/ITransformationErrorManager.h>
 #include <anvill/Result.h>
@@ -30,6 +31,7 @@
 #include <remill/BC/Util.h>
 
 #include <magic_enum.hpp>
+#include <optional>
 #include <sstream>
 #include <unordered_set>
 
@@ -64,8 +66,10 @@ class BaseFunctionPass : public llvm::FunctionPass {
   // Module name
   std::string original_module_name;
 
-  // Module IR, before the function pass
-  std::string original_function_ir;
+  // Function IR, before the function pass. Only captured if the error
+  // manager asks for function snapshots, as printing out every function
+  // before every pass is expensive
+  std::optional<std::string> original_function_ir;
 
   // Current function name
   std::string original_function_name;
@@ -81,9 +85,11 @@ class BaseFunctionPass : public llvm::FunctionPass {
   // Function pass entry point, called by LLVM
   virtual bool runOnFunction(llvm::Function &function) final override;
 
-  // Returns true if this instruction references the stack pointer
+  // Returns true if this instruction references the stack pointer. The same
+  // `sp_resolver` should be used for every instruction of a function, so that
+  // shared derivation chains are only resolved once
   static bool
-  InstructionReferencesStackPointer(const llvm::DataLayout &data_layout,
+  InstructionReferencesStackPointer(const StackPointerResolver &sp_resolver,
                                     const llvm::Instruction &instr);
 
   // Returns true if this is either a store or a load instruction
@@ -134,7 +140,10 @@ bool BaseFunctionPass<UserFunctionPass>::runOnFunction(
     llvm::Function &function_) {
   function = &function_;
   module = function->getParent();
-  original_function_ir = GetFunctionIR(*function);
+  original_function_ir.reset();
+  if (error_manager.CapturesFunctionSnapshots()) {
+    original_function_ir = GetFunctionIR(*function);
+  }
   original_module_name = module->getName().str();
   original_function_name = function->getName().str();
 
@@ -144,7 +153,7 @@ bool BaseFunctionPass<UserFunctionPass>::runOnFunction(
 
 template <typename UserFunctionPass>
 bool BaseFunctionPass<UserFunctionPass>::InstructionReferencesStackPointer(
-    const llvm::DataLayout &data_layout, const llvm::Instruction &instr) {
+    const StackPointerResolver &sp_resolver, const llvm::Instruction &instr) {
 
   auto operand_count = instr.getNumOperands();
 
@@ -152,7 +161,7 @@ bool BaseFunctionPass<UserFunctionPass>::InstructionReferencesStackPointer(
        ++operand_index) {
 
     auto operand = instr.getOperand(operand_index);
-    if (IsRelatedToStackPointer(data_layout, operand)) {
+    if (sp_resolver.IsRelatedToStackPointer(operand)) {
       return true;
     }
   }
@@ -227,9 +236,10 @@ void BaseFunctionPass<UserFunctionPass>::EmitError(SeverityType severity,
   error.function_name = original_function_name;
   error.func_before = original_function_ir;
 
+  // Errors are rare, so we can always afford to print out the current IR.
   auto current_func_ir = GetFunctionIR(*function);
   if (current_func_ir != error.func_before) {
-    error.func_after = current_func_ir;
+    error.func_after = std::move(current_func_ir);
   }
 
   std::stringstream buffer;
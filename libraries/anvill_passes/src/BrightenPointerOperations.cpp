@@ -20,8 +20,10 @@
 #include <anvill/Transforms.h>
 #include <glog/logging.h>
 #include <llvm/ADT/SmallVector.h>
+#include <llvm/IR/InstIterator.h>
 #include <llvm/IR/LegacyPassManager.h>
 #include <llvm/IR/Module.h>
+#include <llvm/IR/ValueHandle.h>
 #include <llvm/Passes/PassBuilder.h>
 #include <remill/BC/Compat/ScalarTransforms.h>
 #include <remill/BC/Util.h>
@@ -41,12 +43,7 @@ PointerLifterPass::PointerLifterPass(unsigned max_gas_)
 
 bool PointerLifterPass::runOnFunction(llvm::Function &f) {
   PointerLifter lifter(&f, max_gas);
-  lifter.LiftFunction(f);
-
-  // TODO (Carson) have an analysis function which determines modifications
-  // Then use lift function to run those modifications
-  // Can return true/false depending on what was modified
-  return true;
+  return lifter.LiftFunction(f);
 }
 
 PointerLifter::PointerLifter(llvm::Function *func_, unsigned max_gas_)
@@ -214,7 +211,6 @@ PointerLifter::visitInstruction(llvm::Instruction &inst) {
 
 void PointerLifter::ReplaceAllUses(llvm::Value *old_val, llvm::Value *new_val) {
   if (auto old_inst = llvm::dyn_cast<llvm::Instruction>(old_val)) {
-    to_remove.insert(old_inst);
     rep_map[old_inst] = new_val;
     made_progress = true;
   } else {
@@ -912,15 +908,18 @@ PointerLifter::visitCmpInst(llvm::CmpInst& inst) {
 /*
 This is the driver code for the pointer lifter
 
-It creates a worklist out of the instructions in the original function and
-visits them. In order to do downstream pointer propagation, additional uses of
-updated values are added into the next_worklist. Pointer lifting for a function
-is done when we reach a fixed point, when the next_worklist is empty.
+The first round visits every instruction in the original function. Inferences
+only flow out of values that were replaced, so every later round only visits
+the replacement values, their operands, and their transitive users, i.e. the
+instructions whose visit could turn out differently than last time. Pointer
+lifting for a function is done when we reach a fixed point, when a round
+doesn't replace anything.
 */
 
-void PointerLifter::LiftFunction(llvm::Function &func) {
-  std::vector<llvm::Instruction *> worklist;
+bool PointerLifter::LiftFunction(llvm::Function &func) {
   std::vector<llvm::GetElementPtrInst*> gep_list;
+  auto changed = false;
+
   // Preprocessing 
   // 1. Flatten geps
   for (auto &block: func) {
@@ -935,6 +934,7 @@ void PointerLifter::LiftFunction(llvm::Function &func) {
     llvm::Value* new_gep = flattenGEP(gep_inst);
     if (gep_inst != new_gep) {
       gep_inst->replaceAllUsesWith(new_gep);
+      changed = true;
     }
   }
   // Deadcode remove stale geps. 
@@ -942,23 +942,35 @@ void PointerLifter::LiftFunction(llvm::Function &func) {
   fpm.add(llvm::createDeadCodeEliminationPass());
   fpm.add(llvm::createDeadInstEliminationPass());
   fpm.doInitialization();
-  fpm.run(func);
+  changed |= fpm.run(func);
   fpm.doFinalization();
 
-  made_progress = true;
-  for (auto i = 0u; i < max_gas && made_progress; ++i) {
+  // NOTE(pag): Dead code elimination runs between rounds, and so the work
+  //            list holds weak handles, which are nulled out when their
+  //            instruction is deleted.
+  std::vector<llvm::WeakVH> worklist;
+  for (auto &inst : llvm::instructions(func)) {
+    worklist.emplace_back(&inst);
+  }
+
+  std::unordered_set<llvm::Value *> seen;
+  std::vector<llvm::Value *> users_worklist;
+
+  for (auto i = 0u; i < max_gas && !worklist.empty(); ++i) {
     made_progress = false;
 
-    for (auto &block : func) {
-      for (auto &inst : block) {
-        worklist.push_back(&inst);
+    for (llvm::Value *val : worklist) {
+      if (auto inst = llvm::dyn_cast_or_null<llvm::Instruction>(val)) {
+        visit(inst);
       }
     }
+    worklist.clear();
 
-    for (auto inst : worklist) {
-      visit(inst);
+    if (!made_progress) {
+      break;
     }
-    worklist.clear();
+
+    changed = true;
 
     // Note (For Peter): The reason we are doing deletion here instead of the
     // end, is that if we don't we keep iterating over what should be dead code,
@@ -966,28 +978,59 @@ void PointerLifter::LiftFunction(llvm::Function &func) {
     // but depending on changes we make, instructions we have seen before might
     // need to be updated anyway... it gets messy. Removing dead code at the end
     // of each iteration guarantees convergence
+    for (auto [inst, rep_val] : rep_map) {
+      if (rep_val && rep_val->getType() == inst->getType()) {
+        inst->replaceAllUsesWith(rep_val);
+      }
+    }
 
-    // NOTE(Carson): We had a thought about how to change this... but i can't remember
-    for (auto inst : to_remove) {
-      if (auto rep_inst = rep_map[inst];
-          rep_inst && rep_inst->getType() == inst->getType()) {
-        inst->replaceAllUsesWith(rep_inst);
+    // Schedule the next round: the replacement values, any instructions
+    // that they're built from, and everything that transitively uses them.
+    seen.clear();
+    for (auto [inst, rep_val] : rep_map) {
+      if (!rep_val || !seen.insert(rep_val).second) {
+        continue;
+      }
+
+      if (auto rep_inst = llvm::dyn_cast<llvm::Instruction>(rep_val)) {
+        worklist.emplace_back(rep_inst);
+        for (auto &op : rep_inst->operands()) {
+          if (auto op_inst = llvm::dyn_cast<llvm::Instruction>(op.get());
+              op_inst && seen.insert(op_inst).second) {
+            worklist.emplace_back(op_inst);
+          }
+        }
+      }
+
+      users_worklist.push_back(rep_val);
+      while (!users_worklist.empty()) {
+        auto val = users_worklist.back();
+        users_worklist.pop_back();
+        for (auto user : val->users()) {
+          if (auto user_inst = llvm::dyn_cast<llvm::Instruction>(user);
+              user_inst && seen.insert(user_inst).second) {
+            worklist.emplace_back(user_inst);
+            users_worklist.push_back(user_inst);
+          }
+        }
       }
     }
-    for (auto inst : to_remove) {
+
+    for (auto [inst, rep_val] : rep_map) {
       if (inst->use_empty()) {
-        inst->eraseFromParent();
-        rep_map.erase(inst);
         inferred_types.erase(inst);
         next_inferred_types.erase(inst);
+        inst->eraseFromParent();
       }
     }
-    to_remove.clear();
+    rep_map.clear();
 
     fpm.doInitialization();
     fpm.run(func);
     fpm.doFinalization();
   }
+
+  return changed;
 }
 
 // Anvill-lifted bitcode operates at a very low level, swapping between integer
@@ -50,6 +50,10 @@ class PointerLifterPass final : public llvm::FunctionPass {
 
   bool runOnFunction(llvm::Function &f) final;
 
+  llvm::StringRef getPassName(void) const final {
+    return "BrightenPointerOperations";
+  }
+
  private:
   static char ID;
   const unsigned max_gas;
@@ -99,8 +103,8 @@ class PointerLifter
   llvm::Value *GetIndexedPointer(llvm::IRBuilder<> &ir, llvm::Value *address,
                                  llvm::Value *offset, llvm::Type *t) const;
 
-  // Driver method
-  void LiftFunction(llvm::Function &func);
+  // Driver method. Returns `true` if the function was changed.
+  bool LiftFunction(llvm::Function &func);
 
  private:
   // Maximum number of iterations that `LiftFunction` is allowed to perform.
@@ -109,9 +113,9 @@ class PointerLifter
   std::unordered_map<llvm::Value *, llvm::Type *> inferred_types;
   std::unordered_map<llvm::Value *, llvm::Type *> next_inferred_types;
 
-  std::unordered_set<llvm::Instruction *> to_remove;
+  // Replacements requested during the current round. These are applied in
+  // one batch at the end of the round.
   std::unordered_map<llvm::Instruction *, llvm::Value *> rep_map;
-  std::unordered_map<llvm::Instruction *, bool> dead_inst;
 
   // Whether or not progress has been made, e.g. a new type was inferred.
   bool made_progress{false};
@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2021 Trail of Bits, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <anvill/Transforms.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Pass.h>
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace anvill {
+namespace {
+
+class FixedPointPassGroup final : public llvm::FunctionPass {
+ public:
+  FixedPointPassGroup(std::vector<llvm::FunctionPass *> passes_,
+                      unsigned max_iterations_);
+
+  bool doInitialization(llvm::Module &module) final;
+
+  bool runOnFunction(llvm::Function &func) final;
+
+  bool doFinalization(llvm::Module &module) final;
+
+  llvm::StringRef getPassName(void) const final {
+    return "FixedPointPassGroup";
+  }
+
+ private:
+  static char ID;
+  std::vector<std::unique_ptr<llvm::FunctionPass>> passes;
+  const unsigned max_iterations;
+};
+
+char FixedPointPassGroup::ID = '\0';
+
+FixedPointPassGroup::FixedPointPassGroup(
+    std::vector<llvm::FunctionPass *> passes_, unsigned max_iterations_)
+    : llvm::FunctionPass(ID),
+      max_iterations(max_iterations_ ? max_iterations_ : 1u) {
+  for (auto pass : passes_) {
+    passes.emplace_back(pass);
+  }
+}
+
+bool FixedPointPassGroup::doInitialization(llvm::Module &module) {
+  auto changed = false;
+  for (auto &pass : passes) {
+    changed |= pass->doInitialization(module);
+  }
+  return changed;
+}
+
+bool FixedPointPassGroup::doFinalization(llvm::Module &module) {
+  auto changed = false;
+  for (auto &pass : passes) {
+    changed |= pass->doFinalization(module);
+  }
+  return changed;
+}
+
+// Run the passes in order, over and over, until none of them has anything
+// left to do. A pass only has something to do if another pass changed the
+// function since it last ran; we assume that running a pass twice in a row
+// doesn't do anything the first run didn't.
+bool FixedPointPassGroup::runOnFunction(llvm::Function &func) {
+  if (func.isDeclaration()) {
+    return false;
+  }
+
+  const auto num_passes = passes.size();
+  std::vector<bool> is_stale(num_passes, true);
+  auto num_stale = num_passes;
+  auto changed = false;
+
+  for (auto i = 0u; i < max_iterations && num_stale; ++i) {
+    for (auto p = 0u; p < num_passes; ++p) {
+      if (!is_stale[p]) {
+        continue;
+      }
+
+      is_stale[p] = false;
+      --num_stale;
+
+      if (!passes[p]->runOnFunction(func)) {
+        continue;
+      }
+
+      changed = true;
+      for (auto q = 0u; q < num_passes; ++q) {
+        if (q != p && !is_stale[q]) {
+          is_stale[q] = true;
+          ++num_stale;
+        }
+      }
+    }
+  }
+
+  return changed;
+}
+
+}  // namespace
+
+// Runs the function passes in `passes` over each function until none of them
+// changes the function any more, or until `max_iterations` rounds have run.
+llvm::FunctionPass *
+CreateFixedPointPassGroup(std::vector<llvm::FunctionPass *> passes,
+                          unsigned max_iterations) {
+  return new FixedPointPassGroup(std::move(passes), max_iterations);
+}
+
+}  // namespace anvill
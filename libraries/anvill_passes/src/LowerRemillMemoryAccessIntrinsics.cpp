@@ -34,6 +34,10 @@ class LowerRemillMemoryAccessIntrinsics final : public llvm::FunctionPass {
 
   bool runOnFunction(llvm::Function &func) final;
 
+  llvm::StringRef getPassName(void) const final {
+    return "LowerRemillMemoryAccessIntrinsics";
+  }
+
  private:
   static char ID;
 };
@@ -34,6 +34,10 @@ class LowerRemillUndefinedIntrinsics final : public llvm::FunctionPass {
 
   bool runOnFunction(llvm::Function &func) override;
 
+  llvm::StringRef getPassName(void) const final {
+    return "LowerRemillUndefinedIntrinsics";
+  }
+
  private:
   static char ID;
 };
@@ -34,6 +34,10 @@ class LowerTypeHintIntrinsics final : public llvm::FunctionPass {
 
   bool runOnFunction(llvm::Function &func) override;
 
+  llvm::StringRef getPassName(void) const final {
+    return "LowerTypeHintIntrinsics";
+  }
+
  private:
   static char ID;
 };
@@ -20,14 +20,52 @@
 #include <anvill/Decl.h>
 #include <anvill/Lifters/Options.h>
 #include <anvill/Lifters/ValueLifter.h>
+#include <anvill/Providers/MemoryProvider.h>
 #include <anvill/Providers/TypeProvider.h>
 #include <llvm/IR/Constant.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/InstIterator.h>
 #include <remill/Arch/Arch.h>
 #include <remill/BC/Util.h>
 
+#include <iterator>
+#include <unordered_set>
+#include <vector>
+
 #include "Utils.h"
 
 namespace anvill {
+namespace {
+
+// Returns `true` if the cross-reference resolver can derive the resolution
+// of `inst` from the resolutions of its operands.
+static bool IsResolvableInstruction(const llvm::Instruction *inst) {
+  switch (inst->getOpcode()) {
+    case llvm::Instruction::Add:
+    case llvm::Instruction::Sub:
+    case llvm::Instruction::Mul:
+    case llvm::Instruction::And:
+    case llvm::Instruction::Or:
+    case llvm::Instruction::Xor:
+    case llvm::Instruction::Shl:
+    case llvm::Instruction::LShr:
+    case llvm::Instruction::AShr:
+    case llvm::Instruction::SDiv:
+    case llvm::Instruction::UDiv:
+    case llvm::Instruction::SRem:
+    case llvm::Instruction::URem:
+    case llvm::Instruction::ZExt:
+    case llvm::Instruction::SExt:
+    case llvm::Instruction::Trunc:
+    case llvm::Instruction::IntToPtr:
+    case llvm::Instruction::PtrToInt:
+    case llvm::Instruction::BitCast:
+    case llvm::Instruction::Call: return true;
+    default: return false;
+  }
+}
+
+}  // namespace
 
 RecoverEntityUseInformation *
 RecoverEntityUseInformation::Create(ITransformationErrorManager &error_manager,
@@ -58,7 +96,7 @@ bool RecoverEntityUseInformation::Run(llvm::Function &function) {
     return false;
   }
 
-  return true;
+  return update_func_res.Value();
 }
 
 llvm::StringRef RecoverEntityUseInformation::getPassName(void) const {
@@ -77,29 +115,74 @@ EntityUsages RecoverEntityUseInformation::EnumeratePossibleEntityUsages(
   const auto mem_ptr_type = arch->MemoryPointerType();
   const auto state_ptr_type = arch->StatePointerType();
 
-  for (auto &basic_block : function) {
-    for (auto &instr : basic_block) {
-      for (auto i = 0u, num_ops = instr.getNumOperands(); i < num_ops; ++i) {
-        auto &use = instr.getOperandUse(i);
-        auto val = use.get();
-
-        // If we see something related to Remill's `Memory *` or `State *` then
-        // ignore those as being possible cross-references.
-        const auto val_type = val->getType();
-        if (val_type == mem_ptr_type || val_type == state_ptr_type) {
-          continue;
-        }
+  // Seed the candidate uses with the operands that are global values,
+  // constant expressions, e.g. `__anvill_pc`-relative expressions, or integer
+  // constants that land in valid memory. Then follow the use lists of the instructions computing values from those
+  // candidates, as only their uses can in turn resolve to something.
+  std::unordered_set<llvm::Use *> candidate_uses;
+  std::unordered_set<llvm::Instruction *> derived_insts;
+  std::vector<llvm::Instruction *> work_list;
+
+  auto add_derived = [&](llvm::Instruction *inst) {
+    if (IsResolvableInstruction(inst) && derived_insts.insert(inst).second) {
+      work_list.push_back(inst);
+    }
+  };
+
+  for (auto &instr : llvm::instructions(function)) {
+    for (auto &use : instr.operands()) {
+      if (IsPossibleEntityConstant(use.get())) {
+        candidate_uses.insert(&use);
+        add_derived(&instr);
+      }
+    }
+  }
+
+  while (!work_list.empty()) {
+    const auto inst = work_list.back();
+    work_list.pop_back();
+    for (auto &use : inst->uses()) {
+      if (auto user = llvm::dyn_cast<llvm::Instruction>(use.getUser())) {
+        candidate_uses.insert(&use);
+        add_derived(user);
+      }
+    }
+  }
+
+  if (candidate_uses.empty()) {
+    return output;
+  }
+
+  // Visit the candidates in instruction order, so that the uses of a value
+  // are patched after the uses within its defining instruction.
+  for (auto &instr : llvm::instructions(function)) {
+    for (auto &use : instr.operands()) {
+      if (!candidate_uses.count(&use)) {
+        continue;
+      }
+
+      auto val = use.get();
+
+      // If we see something related to Remill's `Memory *` or `State *` then
+      // ignore those as being possible cross-references.
+      const auto val_type = val->getType();
+      if (val_type == mem_ptr_type || val_type == state_ptr_type) {
+        continue;
+      }
+
+      if (auto ra = xref_resolver.TryResolveReference(val);
+          ra.is_valid && !ra.references_return_address &&
+          !ra.references_stack_pointer) {
 
-        if (auto ra = xref_resolver.TryResolveReference(val);
-            ra.is_valid && !ra.references_return_address &&
-            !ra.references_stack_pointer) {
+        if (ra.references_entity ||  // Related to an existing lifted entity.
+            ra.references_global_value ||  // Related to a global var/func.
+            ra.references_program_counter) {  // Related to `__anvill_pc`.
+          output.emplace_back(&use, ra);
 
-          if (ra.hinted_value_type ||  // Looked like a pointer.
-              ra.references_entity ||  // Related to an existing lifted entity.
-              ra.references_global_value ||  // Related to a global var/func.
-              ra.references_program_counter) {  // Related to `__anvill_pc`.
-            output.emplace_back(&use, ra);
-          }
+        // Looked like a pointer, but was computed only from constant
+        // integers, so check that it's plausibly the address of something.
+        } else if (ra.hinted_value_type && MayBeEntityAddress(ra)) {
+          output.emplace_back(&use, ra);
         }
       }
     }
@@ -108,8 +191,72 @@ EntityUsages RecoverEntityUseInformation::EnumeratePossibleEntityUsages(
   return output;
 }
 
+// Returns `true` if `val` is a constant that may resolve to a cross-reference
+// on its own. Integer constants only resolve to something when some
+// instruction casts them into a pointer, so they are only considered when they
+// land in valid memory.
+bool RecoverEntityUseInformation::IsPossibleEntityConstant(llvm::Value *val) {
+  if (llvm::isa<llvm::GlobalValue>(val) || llvm::isa<llvm::ConstantExpr>(val)) {
+    return true;
+
+  } else if (auto ci = llvm::dyn_cast<llvm::ConstantInt>(val)) {
+    if (ci->getBitWidth() > 64u) {
+      return false;
+    }
+    const auto ea = ci->getZExtValue();
+    return ea && IsValidAddress(ea);
+
+  } else {
+    return false;
+  }
+}
+
+// Returns `true` if `ea` is a valid address according to the memory provider.
+// Only addresses outside of the ranges seen so far go to the memory provider.
+bool RecoverEntityUseInformation::IsValidAddress(uint64_t ea) {
+  if (auto it = valid_ranges.upper_bound(ea); it != valid_ranges.begin()) {
+    if (ea < std::prev(it)->second) {
+      return true;
+    }
+  }
+
+  const auto [begin, end] = entity_lifter.MemoryProvider().RangeContaining(ea);
+  if (begin <= ea && ea < end) {
+    valid_ranges[begin] = end;
+    return true;
+  }
+  return false;
+}
+
+// Returns `true` if the address in `ra` may belong to an entity. This is a
+// cheap range check that avoids trying to lift pointers out of arbitrary
+// integer constants.
+bool RecoverEntityUseInformation::MayBeEntityAddress(
+    const ResolvedCrossReference &ra) {
+  const auto ea = ra.u.address;
+  if (!ea) {
+    return false;
+  }
+
+  // Function pointers can be lifted on-demand, even when the address isn't
+  // mapped, e.g. for external functions.
+  if (ra.hinted_value_type && ra.hinted_value_type->isFunctionTy()) {
+    return true;
+  }
+
+  if (IsValidAddress(ea)) {
+    return true;
+  }
+
+  // Declared entities need not be backed by mapped memory.
+  auto &type_provider = entity_lifter.TypeProvider();
+  const auto &dl = entity_lifter.Options().module->getDataLayout();
+  return type_provider.TryGetFunctionType(ea).has_value() ||
+         type_provider.TryGetVariableType(ea, dl).has_value();
+}
+
 // Patches the function, replacing the uses known to the entity entity_lifter.
-Result<std::monostate, EntityReferenceErrorCode>
+Result<bool, EntityReferenceErrorCode>
 RecoverEntityUseInformation::UpdateFunction(llvm::Function &function,
                                             const EntityUsages &uses) {
 
@@ -118,6 +265,7 @@ RecoverEntityUseInformation::UpdateFunction(llvm::Function &function,
   const auto module = function.getParent();
   const auto &dl = module->getDataLayout();
   auto &context = module->getContext();
+  auto changed = false;
 
   for (auto xref_use : uses) {
     const auto val = xref_use.use->get();
@@ -197,17 +345,25 @@ RecoverEntityUseInformation::UpdateFunction(llvm::Function &function,
                          entity->getType()->getPointerAddressSpace()));
         entity = ir.CreatePtrToInt(entity, intptr_ty);
         entity = ir.CreateZExtOrTrunc(entity, val->getType());
-        xref_use.use->set(entity);
 
       } else if (val_type->isPointerTy()) {
         entity = ir.CreatePointerBitCastOrAddrSpaceCast(entity, val_type);
-        xref_use.use->set(entity);
 
       } else {
 
         // TODO(pag): Report error/warning?
+        continue;
       }
 
+      // Already recovered, e.g. a direct callee, or a `ptrtoint` of a lifted
+      // variable. Leave it be, so that repeated runs of this pass converge.
+      if (entity == val) {
+        continue;
+      }
+
+      xref_use.use->set(entity);
+      changed = true;
+
       if (auto val_inst = llvm::dyn_cast<llvm::Instruction>(val);
           val_inst && val_inst->use_empty()) {
         val_inst->eraseFromParent();
@@ -219,7 +375,7 @@ RecoverEntityUseInformation::UpdateFunction(llvm::Function &function,
     }
   }
 
-  return std::monostate();
+  return changed;
 }
 
 RecoverEntityUseInformation::RecoverEntityUseInformation(
@@ -22,6 +22,8 @@
 #include <anvill/Lifters/ValueLifter.h>
 #include <anvill/Result.h>
 
+#include <cstdint>
+#include <map>
 #include <unordered_map>
 
 #include "BaseFunctionPass.h"
@@ -67,6 +69,11 @@ class RecoverEntityUseInformation final
   // Used for summarizing/folding values into possible referenced addresses.
   const CrossReferenceResolver xref_resolver;
 
+  // Address ranges, `[begin, end)`, keyed by `begin`, that the memory provider
+  // reported as valid. Integer constants are checked against these before
+  // asking the memory provider, as most of them land in the same few ranges.
+  std::map<uint64_t, uint64_t> valid_ranges;
+
  public:
   // Creates a new RecoverStackFrameInformation object
   static RecoverEntityUseInformation *
@@ -84,8 +91,19 @@ class RecoverEntityUseInformation final
   EntityUsages EnumeratePossibleEntityUsages(
       llvm::Function &function);
 
+  // Returns `true` if `val` is a constant that may resolve to a cross-reference
+  // on its own.
+  bool IsPossibleEntityConstant(llvm::Value *val);
+
+  // Returns `true` if `ea` is a valid address according to the memory provider.
+  bool IsValidAddress(uint64_t ea);
+
+  // Returns `true` if the address in `ra` may belong to an entity.
+  bool MayBeEntityAddress(const ResolvedCrossReference &ra);
+
   // Patches the function, replacing the uses known to the entity lifter.
-  Result<std::monostate, EntityReferenceErrorCode>
+  // Returns `true` if any use was replaced.
+  Result<bool, EntityReferenceErrorCode>
   UpdateFunction(llvm::Function &function, const EntityUsages &uses);
 
   RecoverEntityUseInformation(ITransformationErrorManager &error_manager,
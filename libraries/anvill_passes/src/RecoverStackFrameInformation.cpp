@@ -19,8 +19,11 @@
 #include "RecoverStackFrameInformation.h"
 
 #include <anvill/Analysis/CrossReferenceResolver.h>
+#include <anvill/Analysis/StackPointerResolver.h>
 #include <remill/BC/Util.h>
 
+#include <algorithm>
+#include <cstdlib>
 #include <iostream>
 #include <limits>
 #include <magic_enum.hpp>
@@ -59,7 +62,8 @@ bool RecoverStackFrameInformation::Run(llvm::Function &function) {
   // instructions
   auto update_func_res = UpdateFunction(
       function, stack_frame_analysis, options.stack_frame_struct_init_procedure,
-      options.stack_frame_lower_padding, options.stack_frame_higher_padding);
+      options.stack_frame_lower_padding, options.stack_frame_higher_padding,
+      options.partition_stack_frames);
 
   if (!update_func_res.Succeeded()) {
     EmitError(
@@ -106,12 +110,16 @@ RecoverStackFrameInformation::EnumerateStackPointerUsages(
   auto module = function.getParent();
   auto data_layout = module->getDataLayout();
 
+  // Operands of different instructions commonly share the same derivation
+  // chains from the stack pointer, so resolve each value only once.
+  StackPointerResolver sp_resolver(data_layout);
+
   for (auto &basic_block : function) {
     for (auto &instr : basic_block) {
       for (auto i = 0u, num_ops = instr.getNumOperands(); i < num_ops; ++i) {
         auto &use = instr.getOperandUse(i);
         auto val = use.get();
-        if (IsRelatedToStackPointer(data_layout, val)) {
+        if (sp_resolver.IsRelatedToStackPointer(val)) {
           output.emplace_back(&use);
         }
       }
@@ -238,26 +246,38 @@ RecoverStackFrameInformation::GenerateStackFrameType(
   return stack_frame_type;
 }
 
+std::int64_t
+RecoverStackFrameInformation::SymbolicStackWindowBase(std::int64_t offset) {
+  if (offset >= 0) {
+    return (offset / kSymbolicStackWindowSize) * kSymbolicStackWindowSize;
+  } else {
+    return -(((-offset) + kSymbolicStackWindowSize - 1) /
+             kSymbolicStackWindowSize) *
+           kSymbolicStackWindowSize;
+  }
+}
+
 Result<llvm::GlobalVariable *, StackAnalysisErrorCode>
-RecoverStackFrameInformation::GetStackSymbolicByteValue(llvm::Module &module,
-                                                        std::int32_t offset) {
+RecoverStackFrameInformation::GetStackSymbolicWindow(
+    llvm::Module &module, std::int64_t window_offset) {
 
   // Create a new name
-  auto value_name = kSymbolicStackFrameValuePrefix;
-  if (offset < 0) {
+  auto value_name = kSymbolicStackFrameValuePrefix + "window_";
+  if (window_offset < 0) {
     value_name += "minus_";
-  } else if (offset > 0) {
+  } else if (window_offset > 0) {
     value_name += "plus_";
   }
 
-  value_name += std::to_string(abs(offset));
+  value_name += std::to_string(std::abs(window_offset));
 
   // Get the symbolic value; this will fail if we already have
   // one with the same name but wrong type
   auto &context = module.getContext();
-  auto byte_type = llvm::Type::getInt8Ty(context);
+  auto window_type = llvm::ArrayType::get(llvm::Type::getInt8Ty(context),
+                                          kSymbolicStackWindowSize);
 
-  auto symbolic_value_res = GetSymbolicValue(module, byte_type, value_name);
+  auto symbolic_value_res = GetSymbolicValue(module, window_type, value_name);
   if (!symbolic_value_res.Succeeded()) {
     return StackAnalysisErrorCode::StackInitializationError;
   }
@@ -265,18 +285,259 @@ RecoverStackFrameInformation::GetStackSymbolicByteValue(llvm::Module &module,
   return symbolic_value_res.TakeValue();
 }
 
+Result<std::monostate, StackAnalysisErrorCode>
+RecoverStackFrameInformation::InitializeSymbolicStackBytes(
+    llvm::IRBuilder<> &builder, llvm::Module &module, std::int64_t begin_offset,
+    std::int64_t end_offset,
+    llvm::function_ref<llvm::Value *(std::int64_t)> get_stack_byte) {
+
+  for (auto offset = begin_offset; offset < end_offset;) {
+    const auto window_begin = SymbolicStackWindowBase(offset);
+    const auto copy_end =
+        std::min(window_begin + kSymbolicStackWindowSize, end_offset);
+
+    auto symbolic_window_res = GetStackSymbolicWindow(module, window_begin);
+    if (!symbolic_window_res.Succeeded()) {
+      return symbolic_window_res.TakeError();
+    }
+
+    auto symbolic_window = symbolic_window_res.TakeValue();
+
+    const auto window_index = static_cast<std::int32_t>(offset - window_begin);
+    auto symbolic_bytes = builder.CreateGEP(
+        symbolic_window, {builder.getInt32(0), builder.getInt32(window_index)});
+
+    builder.CreateMemCpy(get_stack_byte(offset), llvm::MaybeAlign(1),
+                         symbolic_bytes, llvm::MaybeAlign(1),
+                         static_cast<std::uint64_t>(copy_end - offset));
+
+    offset = copy_end;
+  }
+
+  return std::monostate();
+}
+
+std::vector<StackFrameSlot> RecoverStackFrameInformation::PartitionStackFrame(
+    const StackFrameAnalysis &stack_frame_analysis,
+    std::size_t stack_frame_lower_padding,
+    std::size_t stack_frame_higher_padding) {
+
+  std::vector<StackFrameSlot> slots;
+  if (stack_frame_analysis.instruction_uses.empty()) {
+    return slots;
+  }
+
+  // Describe the bytes accessed by each use of the stack pointer.
+  std::vector<StackFrameSlot> accesses;
+  accesses.reserve(stack_frame_analysis.instruction_uses.size());
+
+  for (const auto &sp_use : stack_frame_analysis.instruction_uses) {
+    StackFrameSlot access;
+    access.begin_offset = sp_use.stack_offset;
+    access.end_offset =
+        sp_use.stack_offset +
+        std::max<std::int64_t>(1, static_cast<std::int64_t>(sp_use.type_size));
+
+    const auto user = sp_use.use->getUser();
+    if (auto load_inst = llvm::dyn_cast<llvm::LoadInst>(user)) {
+      access.value_type = load_inst->getType();
+
+    } else if (auto store_inst = llvm::dyn_cast<llvm::StoreInst>(user);
+               store_inst && sp_use.use->getOperandNo() == 1) {
+      access.value_type = store_inst->getValueOperand()->getType();
+
+    // The address escapes, e.g. into a call, a stored value, or some pointer
+    // arithmetic. Any part of the frame, above or below it, may be reachable
+    // through it, so keep the whole frame together.
+    } else {
+      StackFrameSlot frame;
+      frame.begin_offset = stack_frame_analysis.lowest_offset -
+                           static_cast<std::int64_t>(stack_frame_lower_padding);
+      frame.end_offset = stack_frame_analysis.highest_offset +
+                         static_cast<std::int64_t>(stack_frame_higher_padding);
+      slots.push_back(frame);
+      return slots;
+    }
+
+    accesses.push_back(access);
+  }
+
+  std::sort(accesses.begin(), accesses.end(),
+            [](const StackFrameSlot &lhs, const StackFrameSlot &rhs) {
+              return lhs.begin_offset < rhs.begin_offset;
+            });
+
+  // Merge the overlapping accesses into slots. A slot keeps a value type
+  // only if all of its accesses have the same shape.
+  for (const auto &access : accesses) {
+    if (slots.empty() || access.begin_offset >= slots.back().end_offset) {
+      slots.push_back(access);
+      continue;
+    }
+
+    auto &slot = slots.back();
+    if (access.begin_offset != slot.begin_offset ||
+        access.end_offset != slot.end_offset ||
+        access.value_type != slot.value_type) {
+      slot.value_type = nullptr;
+    }
+
+    slot.end_offset = std::max(slot.end_offset, access.end_offset);
+  }
+
+  if (stack_frame_lower_padding) {
+    slots.front().begin_offset -=
+        static_cast<std::int64_t>(stack_frame_lower_padding);
+    slots.front().value_type = nullptr;
+  }
+
+  if (stack_frame_higher_padding) {
+    slots.back().end_offset +=
+        static_cast<std::int64_t>(stack_frame_higher_padding);
+    slots.back().value_type = nullptr;
+  }
+
+  return slots;
+}
+
+Result<std::monostate, StackAnalysisErrorCode>
+RecoverStackFrameInformation::UpdateFunctionWithStackSlots(
+    llvm::Function &function, const StackFrameAnalysis &stack_frame_analysis,
+    const std::vector<StackFrameSlot> &slots,
+    StackFrameStructureInitializationProcedure init_strategy) {
+
+  if (function.isDeclaration() || slots.empty()) {
+    return StackAnalysisErrorCode::InvalidParameter;
+  }
+
+  auto &module = *function.getParent();
+  auto &entry_block = function.getEntryBlock();
+  auto &insert_point = *entry_block.getFirstInsertionPt();
+
+  llvm::IRBuilder<> builder(&insert_point);
+
+  // Allocate each slot on its own, so that SROA and mem2reg can deal with
+  // them independently.
+  std::vector<llvm::AllocaInst *> slot_allocas;
+  slot_allocas.reserve(slots.size());
+
+  for (const auto &slot : slots) {
+    auto slot_type = slot.value_type;
+    if (!slot_type) {
+      slot_type = llvm::ArrayType::get(
+          builder.getInt8Ty(),
+          static_cast<std::uint64_t>(slot.end_offset - slot.begin_offset));
+    }
+
+    slot_allocas.push_back(builder.CreateAlloca(slot_type));
+  }
+
+  // Returns a pointer to the byte at `offset` in the `i`th slot.
+  auto get_slot_byte = [&](std::size_t i, std::int64_t offset) {
+    const auto slot_alloca = slot_allocas[i];
+    auto byte_ptr = builder.CreateBitCast(
+        slot_alloca, builder.getInt8PtrTy(slot_alloca->getType()
+                                              ->getPointerAddressSpace()));
+    return builder.CreateConstGEP1_64(
+        byte_ptr, static_cast<std::uint64_t>(offset - slots[i].begin_offset));
+  };
+
+  // Pre-initialize the slots if we have been requested to do so.
+  for (auto i = 0u; i < slots.size(); ++i) {
+    const auto slot_alloca = slot_allocas[i];
+    const auto slot_type = slot_alloca->getAllocatedType();
+
+    switch (init_strategy) {
+      case StackFrameStructureInitializationProcedure::kZeroes:
+        builder.CreateStore(llvm::Constant::getNullValue(slot_type),
+                            slot_alloca);
+        break;
+
+      case StackFrameStructureInitializationProcedure::kUndef:
+        builder.CreateStore(llvm::UndefValue::get(slot_type), slot_alloca);
+        break;
+
+      case StackFrameStructureInitializationProcedure::kSymbolic: {
+        auto init_res = InitializeSymbolicStackBytes(
+            builder, module, slots[i].begin_offset, slots[i].end_offset,
+            [&](std::int64_t offset) -> llvm::Value * {
+              return get_slot_byte(i, offset);
+            });
+
+        if (!init_res.Succeeded()) {
+          return init_res.TakeError();
+        }
+        break;
+      }
+
+      case StackFrameStructureInitializationProcedure::kNone: break;
+    }
+  }
+
+  // Point each use of the stack pointer into the slot that contains it.
+  for (auto &sp_use : stack_frame_analysis.instruction_uses) {
+    auto slot_it = std::upper_bound(
+        slots.begin(), slots.end(), sp_use.stack_offset,
+        [](std::int64_t offset, const StackFrameSlot &slot) {
+          return offset < slot.begin_offset;
+        });
+
+    if (slot_it == slots.begin()) {
+      return StackAnalysisErrorCode::InternalError;
+    }
+
+    --slot_it;
+    if (sp_use.stack_offset >= slot_it->end_offset) {
+      return StackAnalysisErrorCode::InternalError;
+    }
+
+    const auto i = static_cast<std::size_t>(slot_it - slots.begin());
+    const auto instr = llvm::dyn_cast<llvm::Instruction>(sp_use.use->getUser());
+    const auto obj = sp_use.use->get();
+
+    // Set the insert point just before the instruction we have to update
+    builder.SetInsertPoint(instr);
+
+    llvm::Value *slot_ptr = slot_allocas[i];
+    if (sp_use.stack_offset != slot_it->begin_offset) {
+      slot_ptr = get_slot_byte(i, sp_use.stack_offset);
+    }
+
+    slot_ptr = builder.CreateBitOrPointerCast(slot_ptr, obj->getType());
+
+    // As in `UpdateFunction`, only replace this one use of the (possibly
+    // constant) stack pointer expression.
+    sp_use.use->set(slot_ptr);
+  }
+
+  return std::monostate();
+}
+
 Result<std::monostate, StackAnalysisErrorCode>
 RecoverStackFrameInformation::UpdateFunction(
     llvm::Function &function, const StackFrameAnalysis &stack_frame_analysis,
     StackFrameStructureInitializationProcedure init_strategy,
     std::size_t stack_frame_lower_padding,
-    std::size_t stack_frame_higher_padding) {
+    std::size_t stack_frame_higher_padding, bool partition_frame) {
 
   if (function.isDeclaration() ||
       stack_frame_analysis.instruction_uses.empty()) {
     return StackAnalysisErrorCode::InvalidParameter;
   }
 
+  // If the frame splits into several slots, then allocate those instead of
+  // one big frame. Otherwise, fall back on a byte array frame, which can
+  // later be split at the return address.
+  if (partition_frame) {
+    auto slots = PartitionStackFrame(stack_frame_analysis,
+                                     stack_frame_lower_padding,
+                                     stack_frame_higher_padding);
+    if (slots.size() > 1u) {
+      return UpdateFunctionWithStackSlots(function, stack_frame_analysis,
+                                          slots, init_strategy);
+    }
+  }
+
   // Generate a new stack frame type, using a byte array inside a
   // StructType
   auto padding_bytes = stack_frame_lower_padding + stack_frame_higher_padding;
@@ -301,8 +562,8 @@ RecoverStackFrameInformation::UpdateFunction(
 
   // When we have padding enabled in the configuration, we must
   // make sure that accesses are still correctly centered around the
-  // stack pointer we were given (i.e.: we don't alter where the
-  // `__anvill_stack_0` is supposed to land).
+  // stack pointer we were given (i.e.: we don't alter where the byte at
+  // offset zero, `__anvill_stack_window_0[0]`, is supposed to land).
   //
   // This is true regardless of which initialization method we use, but
   // the following example assumes kSymbolic since it makes the
@@ -310,15 +571,15 @@ RecoverStackFrameInformation::UpdateFunction(
   //
   //     [higher addresses]
   //
-  //     [__anvill_stack_plus_3    <- optional higher padding]
+  //     [__anvill_stack_window_0[3]            <- optional higher padding]
   //
-  //     __anvill_stack_plus_2
-  //     __anvill_stack_plus_1
-  //     __anvill_stack_0          <- __anvill_sp
-  //     __anvill_stack_minus_1
-  //     __anvill_stack_minus_2
+  //     __anvill_stack_window_0[2]
+  //     __anvill_stack_window_0[1]
+  //     __anvill_stack_window_0[0]             <- __anvill_sp
+  //     __anvill_stack_window_minus_4096[4095]
+  //     __anvill_stack_window_minus_4096[4094]
   //
-  //     [__anvill_stack_minus_3   <- optional lower padding]
+  //     [__anvill_stack_window_minus_4096[4093] <- optional lower padding]
   //
   //     [lower addresses]
 
@@ -351,31 +612,29 @@ RecoverStackFrameInformation::UpdateFunction(
 
     case StackFrameStructureInitializationProcedure::kSymbolic: {
 
-      // Generate symbolic values for each byte in the stack frame
+      // Copy the symbolic values of the stack frame bytes out of the
+      // symbolic stack windows overlapping with the frame, using one
+      // `memcpy` per window. The windows are shared by all functions, so
+      // the number of globals stays bounded, and large frames don't turn
+      // into one load and store per byte.
       auto &module = *function.getParent();
 
-      auto current_offset = base_stack_offset;
-
-      llvm::Value *gep_indexes[] = {builder.getInt32(0), builder.getInt32(0),
-                                    nullptr};
-
-      for (auto i = 0U; i < total_stack_frame_size; ++i) {
-        gep_indexes[2] = builder.getInt32(i);
-        auto stack_frame_byte =
-            builder.CreateGEP(stack_frame_alloca, gep_indexes);
-
-        auto symbolic_value_ptr_res =
-            GetStackSymbolicByteValue(module, current_offset);
-
-        if (!symbolic_value_ptr_res.Succeeded()) {
-          return symbolic_value_ptr_res.TakeError();
-        }
-
-        auto symbolic_value_ptr = symbolic_value_ptr_res.TakeValue();
-        ++current_offset;
-
-        auto symbolic_value = builder.CreateLoad(symbolic_value_ptr);
-        builder.CreateStore(symbolic_value, stack_frame_byte);
+      const auto frame_begin = static_cast<std::int64_t>(base_stack_offset);
+      const auto frame_end =
+          frame_begin + static_cast<std::int64_t>(total_stack_frame_size);
+
+      auto init_res = InitializeSymbolicStackBytes(
+          builder, module, frame_begin, frame_end,
+          [&](std::int64_t offset) -> llvm::Value * {
+            const auto frame_index =
+                static_cast<std::int32_t>(offset - frame_begin);
+            return builder.CreateGEP(stack_frame_alloca,
+                                     {builder.getInt32(0), builder.getInt32(0),
+                                      builder.getInt32(frame_index)});
+          });
+
+      if (!init_res.Succeeded()) {
+        return init_res.TakeError();
       }
 
       break;
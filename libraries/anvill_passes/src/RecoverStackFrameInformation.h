@@ -19,7 +19,10 @@
 
 #include <anvill/Lifters/Options.h>
 
+#include <llvm/ADT/STLExtras.h>
+
 #include <unordered_map>
+#include <vector>
 
 #include "BaseFunctionPass.h"
 
@@ -79,6 +82,22 @@ struct StackFrameAnalysis final {
   std::size_t size{};
 };
 
+// Describes a region of a stack frame that is accessed independently from
+// the rest of the frame, and so can be allocated on its own.
+struct StackFrameSlot final {
+
+  // Lowest SP-relative offset in this slot
+  std::int64_t begin_offset{};
+
+  // SP-relative offset one past the end of this slot
+  std::int64_t end_offset{};
+
+  // The type of the values accessed in this slot, if every access covers the
+  // whole slot using the same type; otherwise `nullptr`, meaning that the
+  // slot is a byte array.
+  llvm::Type *value_type{nullptr};
+};
+
 // This function pass recovers stack information by analyzing the usage
 // of the `__anvill_sp` symbol
 class RecoverStackFrameInformation final
@@ -116,18 +135,60 @@ class RecoverStackFrameInformation final
                          const StackFrameAnalysis &stack_frame_analysis,
                          std::size_t padding_bytes);
 
-  // Generates a new symbolic stack value
+  // Size, in bytes, of each symbolic stack window.
+  static constexpr std::int64_t kSymbolicStackWindowSize = 4096;
+
+  // Returns the offset of the first byte of the symbolic stack window that
+  // contains the byte at `offset`.
+  static std::int64_t SymbolicStackWindowBase(std::int64_t offset);
+
+  // Gets or creates the symbolic stack window starting at `window_offset`.
+  // This is a byte array global whose element `i` is the symbolic value of
+  // the stack byte at offset `window_offset + i`.
   static Result<llvm::GlobalVariable *, StackAnalysisErrorCode>
-  GetStackSymbolicByteValue(llvm::Module &module, std::int32_t offset);
+  GetStackSymbolicWindow(llvm::Module &module, std::int64_t window_offset);
+
+  // Copies the symbolic values of the stack bytes in the offset range
+  // `[begin_offset, end_offset)` into a recovered stack frame, using one
+  // `memcpy` per symbolic stack window. `get_stack_byte` returns a pointer to
+  // the recovered stack frame's byte at some offset.
+  static Result<std::monostate, StackAnalysisErrorCode>
+  InitializeSymbolicStackBytes(
+      llvm::IRBuilder<> &builder, llvm::Module &module,
+      std::int64_t begin_offset, std::int64_t end_offset,
+      llvm::function_ref<llvm::Value *(std::int64_t)> get_stack_byte);
+
+  // Partitions the stack frame into slots, sorted by offset, such that no
+  // access to the stack frame spans more than one slot. Bytes that are never
+  // accessed don't belong to any slot. The padding bytes extend the lowest
+  // and highest slots. If the address of any part of the frame escapes, then
+  // the whole frame, including padding, is returned as a single slot.
+  static std::vector<StackFrameSlot>
+  PartitionStackFrame(const StackFrameAnalysis &stack_frame_analysis,
+                      std::size_t stack_frame_lower_padding = 0U,
+                      std::size_t stack_frame_higher_padding = 0U);
 
   // Patches the function, replacing the load/store instructions so that
-  // they operate on the new stack frame type we generated
+  // they operate on the new stack frame type we generated. If
+  // `partition_frame` is `true`, then each slot of the frame, as determined
+  // by `PartitionStackFrame`, gets its own allocation instead.
   static Result<std::monostate, StackAnalysisErrorCode>
   UpdateFunction(llvm::Function &function,
                  const StackFrameAnalysis &stack_frame_analysis,
                  StackFrameStructureInitializationProcedure init_strategy,
                  std::size_t stack_frame_lower_padding = 0U,
-                 std::size_t stack_frame_higher_padding = 0U);
+                 std::size_t stack_frame_higher_padding = 0U,
+                 bool partition_frame = false);
+
+  // Patches the function, replacing the load/store instructions so that
+  // they operate on independent allocations for each of the `slots` of the
+  // stack frame.
+  static Result<std::monostate, StackAnalysisErrorCode>
+  UpdateFunctionWithStackSlots(
+      llvm::Function &function,
+      const StackFrameAnalysis &stack_frame_analysis,
+      const std::vector<StackFrameSlot> &slots,
+      StackFrameStructureInitializationProcedure init_strategy);
 
   RecoverStackFrameInformation(ITransformationErrorManager &error_manager,
                                const LifterOptions &options);
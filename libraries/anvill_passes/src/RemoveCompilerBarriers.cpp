@@ -31,6 +31,10 @@ class RemoveCompilerBarriers final : public llvm::FunctionPass {
 
   bool runOnFunction(llvm::Function &func) final;
 
+  llvm::StringRef getPassName(void) const final {
+    return "RemoveCompilerBarriers";
+  }
+
  private:
   static char ID;
 };
@@ -15,8 +15,9 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <anvill/Analysis/Utils.h>
 #include <anvill/Analysis/CrossReferenceResolver.h>
+#include <anvill/Analysis/StackPointerResolver.h>
+#include <anvill/Analysis/Utils.h>
 #include <anvill/Transforms.h>
 #include <glog/logging.h>
 #include <llvm/ADT/Triple.h>
@@ -68,9 +69,14 @@ class RemoveRemillFunctionReturns final : public llvm::FunctionPass {
 
   bool runOnFunction(llvm::Function &func) final;
 
+  llvm::StringRef getPassName(void) const final {
+    return "RemoveRemillFunctionReturns";
+  }
+
  private:
-  ReturnAddressResult QueryReturnAddress(const llvm::DataLayout &dl,
-                                         llvm::Value *val) const;
+  ReturnAddressResult
+  QueryReturnAddress(const StackPointerResolver &sp_resolver,
+                     llvm::Value *val) const;
 
   static char ID;
   const CrossReferenceResolver xref_resolver;
@@ -80,7 +86,7 @@ char RemoveRemillFunctionReturns::ID = '\0';
 
 // Returns `true` if `val` is a return address.
 ReturnAddressResult RemoveRemillFunctionReturns::QueryReturnAddress(
-    const llvm::DataLayout &dl, llvm::Value *val) const {
+    const StackPointerResolver &sp_resolver, llvm::Value *val) const {
 
   if (auto call = llvm::dyn_cast<llvm::CallBase>(val)) {
     if (call->getIntrinsicID() == llvm::Intrinsic::returnaddress) {
@@ -88,7 +94,7 @@ ReturnAddressResult RemoveRemillFunctionReturns::QueryReturnAddress(
     } else if (auto func = call->getCalledFunction()) {
       if (func->getName().startswith("__remill_read_memory_")) {
         auto addr = call->getArgOperand(1);  // Address
-        if (IsRelatedToStackPointer(dl, addr)) {
+        if (sp_resolver.IsRelatedToStackPointer(addr)) {
           return kFoundSymbolicStackPointerLoad;
         } else {
           return kUnclassifiableReturnAddress;
@@ -98,7 +104,7 @@ ReturnAddressResult RemoveRemillFunctionReturns::QueryReturnAddress(
     return kUnclassifiableReturnAddress;
 
   } else if (auto li = llvm::dyn_cast<llvm::LoadInst>(val)) {
-    if (IsRelatedToStackPointer(dl, li->getPointerOperand())) {
+    if (sp_resolver.IsRelatedToStackPointer(li->getPointerOperand())) {
       return kFoundSymbolicStackPointerLoad;
     } else {
       return kUnclassifiableReturnAddress;
@@ -112,12 +118,12 @@ ReturnAddressResult RemoveRemillFunctionReturns::QueryReturnAddress(
     }
 
   } else if (auto pti = llvm::dyn_cast<llvm::PtrToIntOperator>(val)) {
-    return QueryReturnAddress(dl, pti->getOperand(0));
+    return QueryReturnAddress(sp_resolver, pti->getOperand(0));
 
   } else if (auto cast = llvm::dyn_cast<llvm::CastInst>(val)) {
-    return QueryReturnAddress(dl, cast->getOperand(0));
+    return QueryReturnAddress(sp_resolver, cast->getOperand(0));
 
-  } else if (IsRelatedToStackPointer(dl, val)) {
+  } else if (sp_resolver.IsRelatedToStackPointer(val)) {
     return kFoundSymbolicStackPointerLoad;
 
   // Sometimes optimizations result in really crazy looking constant expressions
@@ -245,7 +251,7 @@ static void OverwriteReturnAddress(
 bool RemoveRemillFunctionReturns::runOnFunction(llvm::Function &func) {
 
   const auto module = func.getParent();
-  const auto &dl = module->getDataLayout();
+  const StackPointerResolver sp_resolver(module->getDataLayout());
   std::vector<llvm::CallBase *> matches_pattern;
   std::vector<std::pair<llvm::CallBase *, llvm::Value *>> fixups;
 
@@ -255,7 +261,7 @@ bool RemoveRemillFunctionReturns::runOnFunction(llvm::Function &func) {
           func && func->getName() == "__remill_function_return") {
         auto ret_addr = call->getArgOperand(remill::kPCArgNum)
                             ->stripPointerCastsAndAliases();
-        switch (QueryReturnAddress(dl, ret_addr)) {
+        switch (QueryReturnAddress(sp_resolver, ret_addr)) {
           case kFoundReturnAddress: matches_pattern.push_back(call); break;
 
           // Do nothing if it's a symbolic stack pointer load; we're probably
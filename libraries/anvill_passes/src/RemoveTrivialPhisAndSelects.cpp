@@ -36,6 +36,10 @@ class RemoveTrivialPhisAndSelects final : public llvm::FunctionPass {
 
   bool runOnFunction(llvm::Function &func) final;
 
+  llvm::StringRef getPassName(void) const final {
+    return "RemoveTrivialPhisAndSelects";
+  }
+
  private:
   static char ID;
 };
@@ -34,6 +34,10 @@ class RemoveUnusedFPClassificationCalls final : public llvm::FunctionPass {
 
   bool runOnFunction(llvm::Function &func) final;
 
+  llvm::StringRef getPassName(void) const final {
+    return "RemoveUnusedFPClassificationCalls";
+  }
+
  private:
   static char ID;
 };
@@ -35,6 +35,10 @@ class SinkSelectionsIntoBranchTargets final : public llvm::FunctionPass {
 
   bool runOnFunction(llvm::Function &func) final;
 
+  llvm::StringRef getPassName(void) const final {
+    return "SinkSelectionsIntoBranchTargets";
+  }
+
  private:
   static char ID;
 };
@@ -23,11 +23,14 @@
 #include <llvm/IR/DerivedTypes.h>
 #include <llvm/IR/Function.h>
 #include <llvm/IR/Instruction.h>
+#include <llvm/IR/IntrinsicInst.h>
 #include <llvm/IR/Intrinsics.h>
 #include <remill/BC/Util.h>
 
+#include <algorithm>
 #include <magic_enum.hpp>
 #include <unordered_set>
+#include <vector>
 
 #include "Utils.h"
 
@@ -391,6 +394,82 @@ SplitStackFrameAtReturnAddress::SplitStackFrame(
     return StackFrameSplitErrorCode::InvalidStackFrameSize;
   }
 
+  // Finds the allocated stack frame part containing the byte at `offset`.
+  auto find_part = [&](std::int64_t offset) {
+    return std::find_if(
+        allocated_part_list.begin(), allocated_part_list.end(),
+        [=](const AllocatedStackFramePart &allocated_part) -> bool {
+          return offset >= allocated_part.part_info.start_offset &&
+                 offset <= allocated_part.part_info.end_offset;
+        });
+  };
+
+  //
+  // Split the memory copies that span several stack frame parts
+  //
+
+  // `RecoverStackFrameInformation` initializes symbolic stack frames using
+  // `memcpy`s, which may straddle the return address. Each piece of those
+  // copies goes directly into its new stack frame part.
+  for (auto &gep_instr : stack_analysis.gep_instr_list) {
+    std::vector<llvm::MemCpyInst *> memcpy_list;
+    for (auto user : gep_instr.instr->users()) {
+      if (auto memcpy_instr = llvm::dyn_cast<llvm::MemCpyInst>(user);
+          memcpy_instr && memcpy_instr->getRawDest() == gep_instr.instr &&
+          llvm::isa<llvm::ConstantInt>(memcpy_instr->getLength())) {
+        memcpy_list.push_back(memcpy_instr);
+      }
+    }
+
+    for (auto memcpy_instr : memcpy_list) {
+      const auto copy_size = static_cast<std::int64_t>(
+          llvm::cast<llvm::ConstantInt>(memcpy_instr->getLength())
+              ->getZExtValue());
+      const auto copy_end = gep_instr.offset + copy_size;
+
+      auto part_it = find_part(gep_instr.offset);
+      if (part_it == allocated_part_list.end()) {
+        return StackFrameSplitErrorCode::InternalError;
+      }
+
+      // The copy fits in one part; rewriting its GEP is enough.
+      if (copy_end - 1 <= part_it->part_info.end_offset) {
+        continue;
+      }
+
+      builder.SetInsertPoint(memcpy_instr);
+      const auto source = memcpy_instr->getRawSource();
+
+      for (auto offset = gep_instr.offset; offset < copy_end;) {
+        part_it = find_part(offset);
+        if (part_it == allocated_part_list.end()) {
+          return StackFrameSplitErrorCode::InternalError;
+        }
+
+        const auto &part_info = part_it->part_info;
+        const auto piece_end = std::min(copy_end, part_info.end_offset + 1);
+
+        auto dest = builder.CreateGEP(
+            part_it->alloca_instr,
+            {builder.getInt32(0), builder.getInt32(0),
+             builder.getInt32(
+                 static_cast<std::int32_t>(offset - part_info.start_offset))});
+
+        auto src = builder.CreateConstGEP1_64(
+            source, static_cast<std::uint64_t>(offset - gep_instr.offset));
+
+        builder.CreateMemCpy(dest, llvm::MaybeAlign(1), src,
+                             llvm::MaybeAlign(1),
+                             static_cast<std::uint64_t>(piece_end - offset),
+                             memcpy_instr->isVolatile());
+
+        offset = piece_end;
+      }
+
+      memcpy_instr->eraseFromParent();
+    }
+  }
+
   //
   // Replace the instructions
   //
@@ -69,6 +69,10 @@ class TransformRemillJumpIntrinsics final : public llvm::FunctionPass {
 
   bool runOnFunction(llvm::Function &func) final;
 
+  llvm::StringRef getPassName(void) const final {
+    return "TransformRemillJumpIntrinsics";
+  }
+
  private:
   ReturnAddressResult QueryReturnAddress(const llvm::DataLayout &dl,
                                          llvm::Value *val) const;
@@ -41,9 +41,14 @@ TransformationErrorManager::ErrorList(void) const {
   return error_list;
 }
 
-ITransformationErrorManager::Ptr ITransformationErrorManager::Create(void) {
+bool TransformationErrorManager::CapturesFunctionSnapshots(void) const {
+  return capture_function_snapshots;
+}
+
+ITransformationErrorManager::Ptr
+ITransformationErrorManager::Create(bool capture_function_snapshots) {
   try {
-    return Ptr(new TransformationErrorManager());
+    return Ptr(new TransformationErrorManager(capture_function_snapshots));
 
   } catch (const std::bad_alloc &) {
     return nullptr;
@@ -24,9 +24,11 @@ namespace anvill {
 class TransformationErrorManager final : public ITransformationErrorManager {
   std::vector<TransformationError> error_list;
   bool has_fatal_error{false};
+  const bool capture_function_snapshots;
 
  public:
-  TransformationErrorManager() = default;
+  explicit TransformationErrorManager(bool capture_function_snapshots_)
+      : capture_function_snapshots(capture_function_snapshots_) {}
   virtual ~TransformationErrorManager() override = default;
 
   virtual void Insert(const TransformationError &error) override;
@@ -36,6 +38,8 @@ class TransformationErrorManager final : public ITransformationErrorManager {
 
   virtual const std::vector<TransformationError> &
   ErrorList(void) const override;
+
+  virtual bool CapturesFunctionSnapshots(void) const override;
 };
 
 }  // namespace anvill
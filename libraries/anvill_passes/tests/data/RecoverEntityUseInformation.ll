@@ -0,0 +1,25 @@
+; ModuleID = 'RecoverEntityUseInformation'
+source_filename = "RecoverEntityUseInformation"
+target datalayout = "e-m:e-p270:32:32-p271:32:32-p272:64:64-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-pc-linux-gnu-elf"
+
+@__anvill_pc = external global i8
+
+; Loads the variable at `0x1000` through a `__anvill_pc`-relative pointer, and
+; stores the address of that variable as an integer.
+define i32 @pc_relative_uses(i64* %0) {
+  %2 = load i32, i32* inttoptr (i64 add (i64 ptrtoint (i8* @__anvill_pc to i64), i64 4096) to i32*), align 4
+  store i64 add (i64 ptrtoint (i8* @__anvill_pc to i64), i64 4096), i64* %0, align 8
+  ret i32 %2
+}
+
+; Loads through pointers made from integer constants. Only `0x1000` is mapped,
+; so `0x2000` is not an entity.
+define i32 @integer_uses() {
+  %1 = inttoptr i64 4096 to i32*
+  %2 = load i32, i32* %1, align 4
+  %3 = inttoptr i64 8192 to i32*
+  %4 = load i32, i32* %3, align 4
+  %5 = add i32 %2, %4
+  ret i32 %5
+}
@@ -0,0 +1,27 @@
+; ModuleID = 'lifted_code'
+source_filename = "lifted_code"
+target datalayout = "e-m:e-p:32:32-f64:32:64-f80:32-n8:16:32-S128"
+target triple = "i386-pc-linux-gnu-elf"
+
+@__anvill_sp = external global i8
+
+declare void @sub_8048500__Avi_B_0(i32*)
+
+; Two disjoint, typed accesses to the stack frame, at `__anvill_sp - 8` and
+; `__anvill_sp - 4`.
+define i32 @disjoint_typed_accesses(i32 %0, float %1) {
+  store i32 %0, i32* inttoptr (i32 add (i32 ptrtoint (i8* @__anvill_sp to i32), i32 -8) to i32*), align 4
+  store float %1, float* inttoptr (i32 add (i32 ptrtoint (i8* @__anvill_sp to i32), i32 -4) to float*), align 4
+  %3 = load i32, i32* inttoptr (i32 add (i32 ptrtoint (i8* @__anvill_sp to i32), i32 -8) to i32*), align 4
+  ret i32 %3
+}
+
+; The address of `__anvill_sp - 4` escapes into a call, which can reach the
+; value at `__anvill_sp - 8` through it.
+define i32 @escaping_call(i32 %0) {
+  store i32 %0, i32* inttoptr (i32 add (i32 ptrtoint (i8* @__anvill_sp to i32), i32 -8) to i32*), align 4
+  store i32 %0, i32* inttoptr (i32 add (i32 ptrtoint (i8* @__anvill_sp to i32), i32 -4) to i32*), align 4
+  call void @sub_8048500__Avi_B_0(i32* inttoptr (i32 add (i32 ptrtoint (i8* @__anvill_sp to i32), i32 -4) to i32*))
+  %2 = load i32, i32* inttoptr (i32 add (i32 ptrtoint (i8* @__anvill_sp to i32), i32 -8) to i32*), align 4
+  ret i32 %2
+}
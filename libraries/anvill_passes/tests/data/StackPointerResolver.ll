@@ -0,0 +1,53 @@
+; ModuleID = 'StackPointerResolver'
+source_filename = "StackPointerResolver"
+target datalayout = "e-m:e-p:32:32-f64:32:64-f80:32-n8:16:32-S128"
+target triple = "i386-pc-linux-gnu-elf"
+
+@__anvill_sp = external global i8
+
+; Several instructions share the derivation chain of `%1` and `%2`.
+define i32 @SharedChains(i32 %0) {
+entry:
+  %1 = add i32 ptrtoint (i8* @__anvill_sp to i32), -16
+  %2 = add i32 %1, 4
+  %3 = add i32 %2, 8
+  %4 = mul i32 %2, %0
+  %5 = xor i32 %3, %4
+  %6 = add i32 %0, 1
+  %7 = sub i32 %6, %0
+  %8 = add i32 %5, %7
+  ret i32 %8
+}
+
+; Phi nodes end derivation chains, so the loop-carried `%2` and `%3` are not
+; considered to be related to the stack pointer, even though they start out
+; as `%1`.
+define i32 @PhiLoop(i32 %0) {
+entry:
+  %1 = add i32 ptrtoint (i8* @__anvill_sp to i32), -16
+  br label %loop
+
+loop:
+  %2 = phi i32 [ %1, %entry ], [ %3, %loop ]
+  %3 = add i32 %2, 4
+  %4 = icmp eq i32 %3, %0
+  br i1 %4, label %exit, label %loop
+
+exit:
+  ret i32 %3
+}
+
+; `%2` and `%3` select each other, and `%2` can also be the stack pointer.
+; Such cycles can only exist in unreachable code.
+define i32 @SelectCycle(i1 %0) {
+entry:
+  ret i32 0
+
+unreachable:
+  %1 = select i1 %0, i32 %3, i32 0
+  %2 = select i1 %0, i32 %3, i32 ptrtoint (i8* @__anvill_sp to i32)
+  %3 = select i1 %0, i32 %2, i32 0
+  %4 = add i32 %3, 1
+  %5 = select i1 %0, i32 %1, i32 %1
+  ret i32 %4
+}
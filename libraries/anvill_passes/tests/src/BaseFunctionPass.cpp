@@ -27,6 +27,22 @@
 #include "Utils.h"
 
 namespace anvill {
+namespace {
+
+// A pass that doesn't change anything, and always emits an error.
+class ErrorEmittingPass final : public BaseFunctionPass<ErrorEmittingPass> {
+ public:
+  explicit ErrorEmittingPass(ITransformationErrorManager &error_manager)
+      : BaseFunctionPass(error_manager) {}
+
+  bool Run(llvm::Function &) {
+    EmitError(SeverityType::Error,
+              BaseFunctionPassErrorCode::InvalidSymbolicValueName, "test");
+    return false;
+  }
+};
+
+}  // namespace
 
 TEST_SUITE("BaseFunctionPass") {
   TEST_CASE("BaseFunctionPass::SelectInstructions") {
@@ -69,19 +85,51 @@ TEST_SUITE("BaseFunctionPass") {
 
     // Attempt to run the InstructionReferencesStackPointer method on every
     // instruction
-    auto data_layout = module->getDataLayout();
+    StackPointerResolver sp_resolver(module->getDataLayout());
 
     std::size_t reference_count{};
 
     for (auto &instruction : llvm::instructions(*function)) {
       if (BaseFunctionPass<std::monostate>::InstructionReferencesStackPointer(
-              data_layout, instruction)) {
+              sp_resolver, instruction)) {
         ++reference_count;
       }
     }
 
     CHECK(reference_count == 1U);
   }
+
+  TEST_CASE("BaseFunctionPass::EmitError") {
+    llvm::LLVMContext context;
+    auto module = LoadTestData(context, "BaseFunctionPass.ll");
+    REQUIRE(module != nullptr);
+
+    auto function = module->getFunction("SelectInstructions");
+    REQUIRE(function != nullptr);
+
+    // Without snapshots, only the IR after the pass is available
+    auto error_manager = ITransformationErrorManager::Create();
+    CHECK(!error_manager->CapturesFunctionSnapshots());
+
+    ErrorEmittingPass(*error_manager.get()).runOnFunction(*function);
+    REQUIRE(error_manager->ErrorList().size() == 1U);
+
+    const auto &error = error_manager->ErrorList().front();
+    CHECK(!error.func_before.has_value());
+    CHECK(error.func_after.has_value());
+
+    // With snapshots, the IR before the pass is available, and the IR after
+    // the pass is omitted because the function didn't change
+    error_manager = ITransformationErrorManager::Create(true);
+    CHECK(error_manager->CapturesFunctionSnapshots());
+
+    ErrorEmittingPass(*error_manager.get()).runOnFunction(*function);
+    REQUIRE(error_manager->ErrorList().size() == 1U);
+
+    const auto &snapshot_error = error_manager->ErrorList().front();
+    CHECK(snapshot_error.func_before.has_value());
+    CHECK(!snapshot_error.func_after.has_value());
+  }
 }
 
 }  // namespace anvill
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2021 Trail of Bits, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <anvill/Transforms.h>
+#include <doctest.h>
+#include <llvm/Pass.h>
+
+#include <memory>
+
+#include "Utils.h"
+
+namespace anvill {
+namespace {
+
+// A pass that doesn't actually touch the function, but reports a change on
+// its first `num_changes` runs.
+class CountingPass final : public llvm::FunctionPass {
+ public:
+  CountingPass(unsigned &num_runs_, unsigned num_changes_)
+      : llvm::FunctionPass(ID),
+        num_runs(num_runs_),
+        num_changes(num_changes_) {}
+
+  bool runOnFunction(llvm::Function &) final {
+    return ++num_runs <= num_changes;
+  }
+
+ private:
+  static char ID;
+  unsigned &num_runs;
+  const unsigned num_changes;
+};
+
+char CountingPass::ID = '\0';
+
+}  // namespace
+
+TEST_SUITE("FixedPointPassGroup") {
+  TEST_CASE("Passes are only re-run after another pass changes something") {
+    llvm::LLVMContext context;
+    auto module = LoadTestData(context, "BaseFunctionPass.ll");
+    REQUIRE(module != nullptr);
+
+    auto function = module->getFunction("SelectInstructions");
+    REQUIRE(function != nullptr);
+
+    unsigned num_first_runs = 0;
+    unsigned num_second_runs = 0;
+    unsigned num_third_runs = 0;
+
+    std::unique_ptr<llvm::FunctionPass> group(CreateFixedPointPassGroup(
+        {new CountingPass(num_first_runs, 2u),
+         new CountingPass(num_second_runs, 1u),
+         new CountingPass(num_third_runs, 0u)},
+        8u));
+
+    CHECK(group->runOnFunction(*function));
+
+    // The first round runs everything. The second pass changed something,
+    // so the first pass runs again in the next round. It changes something
+    // again, so the second and third passes run again too. Then nothing is
+    // left to do.
+    CHECK(num_first_runs == 2U);
+    CHECK(num_second_runs == 2U);
+    CHECK(num_third_runs == 2U);
+  }
+
+  TEST_CASE("Iteration stops at the budget") {
+    llvm::LLVMContext context;
+    auto module = LoadTestData(context, "BaseFunctionPass.ll");
+    REQUIRE(module != nullptr);
+
+    auto function = module->getFunction("SelectInstructions");
+    REQUIRE(function != nullptr);
+
+    unsigned num_first_runs = 0;
+    unsigned num_second_runs = 0;
+
+    std::unique_ptr<llvm::FunctionPass> group(CreateFixedPointPassGroup(
+        {new CountingPass(num_first_runs, 100u),
+         new CountingPass(num_second_runs, 100u)},
+        3u));
+
+    CHECK(group->runOnFunction(*function));
+    CHECK(num_first_runs == 3U);
+    CHECK(num_second_runs == 3U);
+  }
+}
+
+}  // namespace anvill
@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) 2021 Trail of Bits, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "RecoverEntityUseInformation.h"
+
+#include <anvill/Decl.h>
+#include <anvill/Lifters/EntityLifter.h>
+#include <anvill/Lifters/Options.h>
+#include <anvill/Program.h>
+#include <anvill/Providers/MemoryProvider.h>
+#include <anvill/Providers/TypeProvider.h>
+#include <anvill/Transforms.h>
+#include <doctest.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/GlobalVariable.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/Support/Error.h>
+#include <remill/Arch/Arch.h>
+#include <remill/Arch/Name.h>
+#include <remill/BC/Util.h>
+#include <remill/OS/OS.h>
+
+#include <memory>
+
+#include "Utils.h"
+
+namespace anvill {
+namespace {
+
+static const uint8_t kVarBytes[] = {0x78, 0x56, 0x34, 0x12};
+
+// Maps the bytes of an `i32` variable at `0x1000`, and declares it.
+static void DeclareTestVariable(Program &program, llvm::LLVMContext &context) {
+  ByteRange range;
+  range.address = 0x1000u;
+  range.begin = &(kVarBytes[0]);
+  range.end = &(kVarBytes[sizeof(kVarBytes)]);
+  REQUIRE(!llvm::errorToBool(program.MapRange(range)));
+
+  GlobalVarDecl var_decl;
+  var_decl.type = llvm::Type::getInt32Ty(context);
+  var_decl.address = 0x1000u;
+  REQUIRE(!llvm::errorToBool(program.DeclareVariable(var_decl)));
+}
+
+}  // namespace
+
+TEST_SUITE("RecoverEntityUseInformation") {
+  SCENARIO("Recovering entity uses reaches a fixed point") {
+    GIVEN("a function with __anvill_pc-relative references to a variable") {
+      llvm::LLVMContext context;
+      auto module = LoadTestData(context, "RecoverEntityUseInformation.ll");
+      REQUIRE(module != nullptr);
+
+      auto arch = remill::Arch::Build(&context, remill::GetOSName("linux"),
+                                      remill::GetArchName("amd64"));
+      REQUIRE(arch != nullptr);
+
+      Program program;
+      DeclareTestVariable(program, context);
+
+      LifterOptions options(arch.get(), *module, nullptr);
+      EntityLifter lifter(
+          options, MemoryProvider::CreateProgramMemoryProvider(program),
+          TypeProvider::CreateProgramTypeProvider(context, program));
+
+      auto function = module->getFunction("pc_relative_uses");
+      REQUIRE(function != nullptr);
+
+      auto load = llvm::dyn_cast<llvm::LoadInst>(&*function->begin()->begin());
+      REQUIRE(load != nullptr);
+      auto store = llvm::dyn_cast<llvm::StoreInst>(load->getNextNode());
+      REQUIRE(store != nullptr);
+
+      auto error_manager = ITransformationErrorManager::Create();
+      std::unique_ptr<RecoverEntityUseInformation> pass(
+          RecoverEntityUseInformation::Create(*error_manager, lifter));
+
+      WHEN("running the pass once") {
+        CHECK(pass->Run(*function));
+        CHECK(VerifyModule(module.get()));
+
+        THEN("the references are replaced with the lifted variable") {
+          auto var = llvm::dyn_cast<llvm::GlobalVariable>(
+              load->getPointerOperand()->stripPointerCasts());
+          REQUIRE(var != nullptr);
+          CHECK(lifter.AddressOfEntity(var) == 0x1000u);
+
+          auto stored_addr =
+              llvm::dyn_cast<llvm::ConstantExpr>(store->getValueOperand());
+          REQUIRE(stored_addr != nullptr);
+          CHECK(stored_addr->getOpcode() == llvm::Instruction::PtrToInt);
+          CHECK(stored_addr->getOperand(0)->stripPointerCasts() == var);
+        }
+
+        THEN("running the pass again over the recovered uses changes nothing") {
+          const auto loaded_ptr = load->getPointerOperand();
+          const auto stored_val = store->getValueOperand();
+
+          CHECK(!pass->Run(*function));
+          CHECK(load->getPointerOperand() == loaded_ptr);
+          CHECK(store->getValueOperand() == stored_val);
+        }
+      }
+
+      for (const auto &error : error_manager->ErrorList()) {
+        CHECK_MESSAGE(false, error.description);
+      }
+    }
+  }
+
+  SCENARIO("Integer constants are only recovered when they are valid "
+           "addresses") {
+    GIVEN("a function with pointers made from mapped and unmapped integers") {
+      llvm::LLVMContext context;
+      auto module = LoadTestData(context, "RecoverEntityUseInformation.ll");
+      REQUIRE(module != nullptr);
+
+      auto arch = remill::Arch::Build(&context, remill::GetOSName("linux"),
+                                      remill::GetArchName("amd64"));
+      REQUIRE(arch != nullptr);
+
+      Program program;
+      DeclareTestVariable(program, context);
+
+      LifterOptions options(arch.get(), *module, nullptr);
+      EntityLifter lifter(
+          options, MemoryProvider::CreateProgramMemoryProvider(program),
+          TypeProvider::CreateProgramTypeProvider(context, program));
+
+      auto function = module->getFunction("integer_uses");
+      REQUIRE(function != nullptr);
+
+      auto mapped_ptr =
+          llvm::dyn_cast<llvm::IntToPtrInst>(&*function->begin()->begin());
+      REQUIRE(mapped_ptr != nullptr);
+      auto mapped_load =
+          llvm::dyn_cast<llvm::LoadInst>(mapped_ptr->getNextNode());
+      REQUIRE(mapped_load != nullptr);
+      auto unmapped_ptr =
+          llvm::dyn_cast<llvm::IntToPtrInst>(mapped_load->getNextNode());
+      REQUIRE(unmapped_ptr != nullptr);
+      auto unmapped_load =
+          llvm::dyn_cast<llvm::LoadInst>(unmapped_ptr->getNextNode());
+      REQUIRE(unmapped_load != nullptr);
+
+      auto error_manager = ITransformationErrorManager::Create();
+      std::unique_ptr<RecoverEntityUseInformation> pass(
+          RecoverEntityUseInformation::Create(*error_manager, lifter));
+
+      WHEN("enumerating the possible entity uses") {
+        const auto uses = pass->EnumeratePossibleEntityUsages(*function);
+
+        THEN("only the pointer made from the mapped integer is a use") {
+          REQUIRE(uses.size() == 1u);
+          CHECK(uses[0].use->getUser() == mapped_load);
+          CHECK(uses[0].xref.u.address == 0x1000u);
+        }
+      }
+
+      WHEN("running the pass") {
+        CHECK(pass->Run(*function));
+        CHECK(VerifyModule(module.get()));
+
+        THEN("the mapped pointer is replaced with the lifted variable") {
+          auto var = llvm::dyn_cast<llvm::GlobalVariable>(
+              mapped_load->getPointerOperand()->stripPointerCasts());
+          REQUIRE(var != nullptr);
+          CHECK(lifter.AddressOfEntity(var) == 0x1000u);
+        }
+
+        THEN("the unmapped pointer is left alone") {
+          CHECK(unmapped_load->getPointerOperand() == unmapped_ptr);
+        }
+      }
+
+      for (const auto &error : error_manager->ErrorList()) {
+        CHECK_MESSAGE(false, error.description);
+      }
+    }
+  }
+}
+
+}  // namespace anvill
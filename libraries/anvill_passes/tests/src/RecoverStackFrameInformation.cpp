@@ -20,13 +20,17 @@
 #include <anvill/ABI.h>
 #include <anvill/Transforms.h>
 #include <doctest.h>
+#include <llvm/IR/IntrinsicInst.h>
 #include <llvm/IR/Verifier.h>
 #include <remill/Arch/Arch.h>
 #include <remill/Arch/Name.h>
+#include <remill/BC/Util.h>
 #include <remill/OS/OS.h>
 
 #include <array>
 #include <sstream>
+#include <tuple>
+#include <vector>
 
 #include "Utils.h"
 
@@ -314,6 +318,237 @@ TEST_SUITE("RecoverStackFrameInformation") {
           CHECK(second_stack_frame_analysis.instruction_uses.empty());
         }
       }
+
+      WHEN("recovering the stack frame with symbolic initialization") {
+        auto stack_frame_analysis_res =
+            RecoverStackFrameInformation::AnalyzeStackFrame(function);
+
+        REQUIRE(stack_frame_analysis_res.Succeeded());
+
+        auto stack_frame_analysis = stack_frame_analysis_res.TakeValue();
+
+        auto count_stores = [&](void) {
+          std::size_t store_count{0U};
+          for (const auto &instr : function.getEntryBlock()) {
+            if (llvm::isa<llvm::StoreInst>(&instr)) {
+              ++store_count;
+            }
+          }
+          return store_count;
+        };
+
+        const auto original_store_count = count_stores();
+
+        auto update_res = RecoverStackFrameInformation::UpdateFunction(
+            function, stack_frame_analysis,
+            StackFrameStructureInitializationProcedure::kSymbolic);
+        REQUIRE(update_res.Succeeded());
+
+        THEN("the frame is copied out of one symbolic window per overlap") {
+
+          // The frame spans from `__anvill_sp - 28` to `__anvill_sp + 16`,
+          // so it overlaps with the two windows around offset zero.
+          CHECK(stack_frame_analysis.lowest_offset == -28);
+          CHECK(stack_frame_analysis.size == 44U);
+          CHECK(RecoverStackFrameInformation::SymbolicStackWindowBase(-28) ==
+                -RecoverStackFrameInformation::kSymbolicStackWindowSize);
+          CHECK(RecoverStackFrameInformation::SymbolicStackWindowBase(12) ==
+                0);
+
+          auto lower_window = module->getGlobalVariable(
+              kSymbolicStackFrameValuePrefix + "window_minus_4096");
+          auto upper_window = module->getGlobalVariable(
+              kSymbolicStackFrameValuePrefix + "window_0");
+
+          REQUIRE(lower_window != nullptr);
+          REQUIRE(upper_window != nullptr);
+
+          // Each window is copied into the part of the frame that it
+          // overlaps with: `[-28, 0)` into frame bytes `[0, 28)`, and
+          // `[0, 16)` into frame bytes `[28, 44)`.
+          const auto &data_layout = module->getDataLayout();
+          std::vector<llvm::MemCpyInst *> memcpy_list;
+          for (auto &instr : function.getEntryBlock()) {
+            if (auto memcpy_instr = llvm::dyn_cast<llvm::MemCpyInst>(&instr)) {
+              memcpy_list.push_back(memcpy_instr);
+            }
+          }
+
+          REQUIRE(memcpy_list.size() == 2U);
+
+          const std::tuple<llvm::GlobalVariable *, std::int64_t, std::int64_t,
+                           std::uint64_t>
+              kExpectedCopies[] = {{lower_window, 4096 - 28, 0, 28U},
+                                   {upper_window, 0, 28, 16U}};
+
+          for (auto i = 0U; i < memcpy_list.size(); ++i) {
+            const auto [window, window_offset, frame_offset, size] =
+                kExpectedCopies[i];
+            const auto memcpy_instr = memcpy_list[i];
+
+            auto length =
+                llvm::dyn_cast<llvm::ConstantInt>(memcpy_instr->getLength());
+            REQUIRE(length != nullptr);
+            CHECK(length->getZExtValue() == size);
+
+            auto dest = remill::StripAndAccumulateConstantOffsets(
+                data_layout, memcpy_instr->getRawDest());
+            CHECK(llvm::isa<llvm::AllocaInst>(std::get<0>(dest)));
+            CHECK(std::get<1>(dest) == frame_offset);
+
+            auto source = remill::StripAndAccumulateConstantOffsets(
+                data_layout, memcpy_instr->getRawSource());
+            CHECK(std::get<0>(source) == window);
+            CHECK(std::get<1>(source) == window_offset);
+          }
+
+          // The frame is initialized without any individual stores.
+          CHECK(count_stores() == original_store_count);
+          CHECK(!llvm::verifyFunction(function, &llvm::errs()));
+        }
+      }
+
+      WHEN("partitioning the stack frame into slots") {
+        auto stack_frame_analysis_res =
+            RecoverStackFrameInformation::AnalyzeStackFrame(function);
+
+        REQUIRE(stack_frame_analysis_res.Succeeded());
+
+        auto stack_frame_analysis = stack_frame_analysis_res.TakeValue();
+        auto slots = RecoverStackFrameInformation::PartitionStackFrame(
+            stack_frame_analysis);
+
+        THEN("the escaping stack addresses keep the frame in one slot") {
+
+          // Some of the stored values are themselves stack addresses.
+          REQUIRE(slots.size() == 1U);
+          CHECK(slots[0].begin_offset == stack_frame_analysis.lowest_offset);
+          CHECK(slots[0].end_offset == stack_frame_analysis.highest_offset);
+          CHECK(slots[0].value_type == nullptr);
+        }
+
+        THEN("the function is updated to use the flat stack frame") {
+          auto update_res = RecoverStackFrameInformation::UpdateFunction(
+              function, stack_frame_analysis,
+              StackFrameStructureInitializationProcedure::kSymbolic, 0U, 0U,
+              true);
+          REQUIRE(update_res.Succeeded());
+
+          std::size_t alloca_count{0U};
+          for (const auto &instr : function.getEntryBlock()) {
+            if (llvm::isa<llvm::AllocaInst>(&instr)) {
+              ++alloca_count;
+            }
+          }
+
+          CHECK(alloca_count == 1U);
+          CHECK(module->getTypeByName(function.getName().str() +
+                                      kStackFrameTypeNameSuffix) != nullptr);
+
+          stack_frame_analysis_res =
+              RecoverStackFrameInformation::AnalyzeStackFrame(function);
+          REQUIRE(stack_frame_analysis_res.Succeeded());
+          CHECK(stack_frame_analysis_res.TakeValue().instruction_uses.empty());
+          CHECK(!llvm::verifyFunction(function, &llvm::errs()));
+        }
+      }
+    }
+  }
+
+  SCENARIO("Stack frames are partitioned into independent slots") {
+    GIVEN("lifted functions with different stack frame accesses") {
+      llvm::LLVMContext context;
+      auto module = LoadTestData(context, "RecoverStackFrameSlots.ll");
+      REQUIRE(module != nullptr);
+
+      // Returns the allocations in the entry block of `function`.
+      auto get_allocas = [](llvm::Function &function) {
+        std::vector<llvm::AllocaInst *> alloca_list;
+        for (auto &instr : function.getEntryBlock()) {
+          if (auto alloca_inst = llvm::dyn_cast<llvm::AllocaInst>(&instr)) {
+            alloca_list.push_back(alloca_inst);
+          }
+        }
+        return alloca_list;
+      };
+
+      WHEN("the frame is accessed as two disjoint, typed values") {
+        auto function = module->getFunction("disjoint_typed_accesses");
+        REQUIRE(function != nullptr);
+
+        auto stack_frame_analysis_res =
+            RecoverStackFrameInformation::AnalyzeStackFrame(*function);
+        REQUIRE(stack_frame_analysis_res.Succeeded());
+
+        auto stack_frame_analysis = stack_frame_analysis_res.TakeValue();
+        auto slots = RecoverStackFrameInformation::PartitionStackFrame(
+            stack_frame_analysis);
+
+        THEN("each value gets its own, typed slot") {
+          REQUIRE(slots.size() == 2U);
+
+          CHECK(slots[0].begin_offset == -8);
+          CHECK(slots[0].end_offset == -4);
+          CHECK(slots[0].value_type == llvm::Type::getInt32Ty(context));
+
+          CHECK(slots[1].begin_offset == -4);
+          CHECK(slots[1].end_offset == 0);
+          CHECK(slots[1].value_type == llvm::Type::getFloatTy(context));
+        }
+
+        THEN("the function is updated to use two typed allocations") {
+          auto update_res = RecoverStackFrameInformation::UpdateFunction(
+              *function, stack_frame_analysis,
+              StackFrameStructureInitializationProcedure::kUndef, 0U, 0U,
+              true);
+          REQUIRE(update_res.Succeeded());
+
+          auto alloca_list = get_allocas(*function);
+          REQUIRE(alloca_list.size() == 2U);
+          CHECK(alloca_list[0]->getAllocatedType() ==
+                llvm::Type::getInt32Ty(context));
+          CHECK(alloca_list[1]->getAllocatedType() ==
+                llvm::Type::getFloatTy(context));
+
+          CHECK(!llvm::verifyFunction(*function, &llvm::errs()));
+        }
+      }
+
+      WHEN("the address of part of the frame escapes into a call") {
+        auto function = module->getFunction("escaping_call");
+        REQUIRE(function != nullptr);
+
+        auto stack_frame_analysis_res =
+            RecoverStackFrameInformation::AnalyzeStackFrame(*function);
+        REQUIRE(stack_frame_analysis_res.Succeeded());
+
+        auto stack_frame_analysis = stack_frame_analysis_res.TakeValue();
+        auto slots = RecoverStackFrameInformation::PartitionStackFrame(
+            stack_frame_analysis, 4U, 4U);
+
+        THEN("the whole frame, including padding, is kept in one slot") {
+          REQUIRE(slots.size() == 1U);
+          CHECK(slots[0].begin_offset == -12);
+          CHECK(slots[0].end_offset == 4);
+          CHECK(slots[0].value_type == nullptr);
+        }
+
+        THEN("the function is updated to use one flat stack frame") {
+          auto update_res = RecoverStackFrameInformation::UpdateFunction(
+              *function, stack_frame_analysis,
+              StackFrameStructureInitializationProcedure::kUndef, 4U, 4U,
+              true);
+          REQUIRE(update_res.Succeeded());
+
+          auto alloca_list = get_allocas(*function);
+          REQUIRE(alloca_list.size() == 1U);
+          CHECK(alloca_list[0]->getAllocatedType() ==
+                module->getTypeByName(function->getName().str() +
+                                      kStackFrameTypeNameSuffix));
+
+          CHECK(!llvm::verifyFunction(*function, &llvm::errs()));
+        }
+      }
     }
   }
 }
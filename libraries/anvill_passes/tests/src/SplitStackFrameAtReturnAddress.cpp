@@ -15,12 +15,20 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "SplitStackFrameAtReturnAddress.h"
+
+#include <anvill/ABI.h>
 #include <anvill/Transforms.h>
 #include <doctest.h>
+#include <llvm/IR/IntrinsicInst.h>
 #include <llvm/IR/Verifier.h>
+#include <remill/BC/Util.h>
 
 #include <iostream>
+#include <tuple>
+#include <vector>
 
+#include "RecoverStackFrameInformation.h"
 #include "Utils.h"
 
 namespace anvill {
@@ -43,6 +51,105 @@ TEST_SUITE("SplitStackFrameAtReturnAddress") {
 
     REQUIRE(error_manager->ErrorList().empty());
   }
+
+  SCENARIO("Copies into the stack frame are split at the return address") {
+    GIVEN("a function whose symbolic stack frame was recovered") {
+      llvm::LLVMContext context;
+      auto module = LoadTestData(context, "RecoverStackFrameInformation.ll");
+      REQUIRE(module != nullptr);
+
+      auto function = module->getFunction("sub_80482e0__Ai_S_Sb_S_Sbi_B_0");
+      REQUIRE(function != nullptr);
+
+      auto stack_frame_analysis_res =
+          RecoverStackFrameInformation::AnalyzeStackFrame(*function);
+      REQUIRE(stack_frame_analysis_res.Succeeded());
+
+      // The frame spans from `__anvill_sp - 28` to `__anvill_sp + 16`, and
+      // is initialized with two copies: frame bytes `[0, 28)` come from
+      // the window below `__anvill_sp`, and frame bytes `[28, 44)` come from
+      // the window above it. The return address is at frame byte 28.
+      auto update_res = RecoverStackFrameInformation::UpdateFunction(
+          *function, stack_frame_analysis_res.TakeValue(),
+          StackFrameStructureInitializationProcedure::kSymbolic);
+      REQUIRE(update_res.Succeeded());
+
+      WHEN("splitting the stack frame") {
+        auto analysis_res =
+            SplitStackFrameAtReturnAddress::AnalyzeFunction(*function);
+        REQUIRE(analysis_res.Succeeded());
+
+        auto analysis = analysis_res.TakeValue();
+        REQUIRE(analysis.stack_frame_parts.size() == 3U);
+        CHECK(analysis.stack_frame_parts[0].start_offset == 0);
+        CHECK(analysis.stack_frame_parts[1].start_offset == 28);
+        CHECK(analysis.stack_frame_parts[2].start_offset == 32);
+
+        auto split_res =
+            SplitStackFrameAtReturnAddress::SplitStackFrame(*function, analysis);
+        REQUIRE(split_res.Succeeded());
+
+        THEN("the copy straddling the return address is split in two") {
+          auto lower_window = module->getGlobalVariable(
+              kSymbolicStackFrameValuePrefix + "window_minus_4096");
+          auto upper_window = module->getGlobalVariable(
+              kSymbolicStackFrameValuePrefix + "window_0");
+
+          REQUIRE(lower_window != nullptr);
+          REQUIRE(upper_window != nullptr);
+
+          const auto &data_layout = module->getDataLayout();
+          std::vector<llvm::MemCpyInst *> memcpy_list;
+          for (auto &instr : function->getEntryBlock()) {
+            if (auto memcpy_instr = llvm::dyn_cast<llvm::MemCpyInst>(&instr)) {
+              memcpy_list.push_back(memcpy_instr);
+            }
+          }
+
+          REQUIRE(memcpy_list.size() == 3U);
+
+          // The first copy fits in the first part, and is left as-is. The
+          // second one is split into a 4 byte copy into the return address
+          // part, and a 12 byte copy into the part above it.
+          const std::tuple<std::size_t, llvm::GlobalVariable *, std::int64_t,
+                           std::uint64_t>
+              kExpectedCopies[] = {{0U, lower_window, 4096 - 28, 28U},
+                                   {1U, upper_window, 0, 4U},
+                                   {2U, upper_window, 4, 12U}};
+
+          for (auto i = 0U; i < memcpy_list.size(); ++i) {
+            const auto [part_number, window, window_offset, size] =
+                kExpectedCopies[i];
+            const auto memcpy_instr = memcpy_list[i];
+
+            auto length =
+                llvm::dyn_cast<llvm::ConstantInt>(memcpy_instr->getLength());
+            REQUIRE(length != nullptr);
+            CHECK(length->getZExtValue() == size);
+
+            auto dest = remill::StripAndAccumulateConstantOffsets(
+                data_layout, memcpy_instr->getRawDest());
+            auto part_alloca =
+                llvm::dyn_cast<llvm::AllocaInst>(std::get<0>(dest));
+            REQUIRE(part_alloca != nullptr);
+            CHECK(part_alloca->getAllocatedType() ==
+                  module->getTypeByName(
+                      SplitStackFrameAtReturnAddress::
+                          GenerateStackFramePartTypeName(*function,
+                                                         part_number)));
+            CHECK(std::get<1>(dest) == 0);
+
+            auto source = remill::StripAndAccumulateConstantOffsets(
+                data_layout, memcpy_instr->getRawSource());
+            CHECK(std::get<0>(source) == window);
+            CHECK(std::get<1>(source) == window_offset);
+          }
+
+          CHECK(!llvm::verifyFunction(*function, &llvm::errs()));
+        }
+      }
+    }
+  }
 }
 
 }  // namespace anvill
@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2021 Trail of Bits, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <anvill/Analysis/StackPointerResolver.h>
+#include <doctest.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/InstIterator.h>
+#include <llvm/IR/Module.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "Utils.h"
+
+namespace anvill {
+namespace {
+
+// Returns the values defined by the instructions of `function`, in order.
+static std::vector<llvm::Value *>
+GetInstructionValues(llvm::Function &function) {
+  std::vector<llvm::Value *> values;
+  for (auto &instr : llvm::instructions(function)) {
+    if (!instr.getType()->isVoidTy()) {
+      values.push_back(&instr);
+    }
+  }
+  return values;
+}
+
+// Asks about every value in `values`, in order, using one resolver, and
+// compares the answers to `expected`. Then asks again about each value using
+// a fresh resolver, so that the answers don't depend on what was memoized.
+static void CheckAnswers(const llvm::DataLayout &dl,
+                         const std::vector<llvm::Value *> &values,
+                         const std::vector<bool> &expected) {
+  REQUIRE(values.size() == expected.size());
+
+  StackPointerResolver sp_resolver(dl);
+  for (auto i = 0U; i < values.size(); ++i) {
+    CHECK(sp_resolver.IsRelatedToStackPointer(values[i]) == expected[i]);
+  }
+
+  for (auto i = 0U; i < values.size(); ++i) {
+    StackPointerResolver fresh_sp_resolver(dl);
+    CHECK(fresh_sp_resolver.IsRelatedToStackPointer(values[i]) == expected[i]);
+  }
+}
+
+// Checks the answers about `values` in both program order and reverse program
+// order.
+static void CheckAnswersInAnyOrder(const llvm::DataLayout &dl,
+                                   std::vector<llvm::Value *> values,
+                                   std::vector<bool> expected) {
+  CheckAnswers(dl, values, expected);
+
+  std::reverse(values.begin(), values.end());
+  std::reverse(expected.begin(), expected.end());
+  CheckAnswers(dl, values, expected);
+}
+
+}  // namespace
+
+TEST_SUITE("StackPointerResolver") {
+  TEST_CASE("Derivation chains shared by several instructions") {
+    llvm::LLVMContext context;
+    auto module = LoadTestData(context, "StackPointerResolver.ll");
+    REQUIRE(module != nullptr);
+
+    auto function = module->getFunction("SharedChains");
+    REQUIRE(function != nullptr);
+
+    const auto &dl = module->getDataLayout();
+    auto values = GetInstructionValues(*function);
+    REQUIRE(values.size() == 8U);
+
+    CheckAnswersInAnyOrder(
+        dl, values, {true, true, true, true, true, false, false, true});
+
+    // The arguments are not related to the stack pointer.
+    StackPointerResolver sp_resolver(dl);
+    CHECK(!sp_resolver.IsRelatedToStackPointer(&*function->arg_begin()));
+  }
+
+  TEST_CASE("Memoized answers are forgotten when cleared") {
+    llvm::LLVMContext context;
+    auto module = LoadTestData(context, "StackPointerResolver.ll");
+    REQUIRE(module != nullptr);
+
+    auto function = module->getFunction("SharedChains");
+    REQUIRE(function != nullptr);
+
+    auto values = GetInstructionValues(*function);
+    REQUIRE(values.size() == 8U);
+
+    StackPointerResolver sp_resolver(module->getDataLayout());
+    CHECK(sp_resolver.IsRelatedToStackPointer(values[2]));
+
+    // Cut the chain at its start, so that nothing derives from the stack
+    // pointer anymore.
+    auto first_instr = llvm::cast<llvm::Instruction>(values[0]);
+    first_instr->setOperand(
+        0, llvm::ConstantInt::get(first_instr->getType(), 0));
+
+    sp_resolver.Clear();
+    for (auto val : values) {
+      CHECK(!sp_resolver.IsRelatedToStackPointer(val));
+    }
+  }
+
+  TEST_CASE("Phi nodes end derivation chains") {
+    llvm::LLVMContext context;
+    auto module = LoadTestData(context, "StackPointerResolver.ll");
+    REQUIRE(module != nullptr);
+
+    auto function = module->getFunction("PhiLoop");
+    REQUIRE(function != nullptr);
+
+    auto values = GetInstructionValues(*function);
+    REQUIRE(values.size() == 4U);
+
+    CheckAnswersInAnyOrder(module->getDataLayout(), values,
+                           {true, false, false, false});
+  }
+
+  TEST_CASE("Cycles through selects don't depend on the order of queries") {
+    llvm::LLVMContext context;
+    auto module = LoadTestData(context, "StackPointerResolver.ll");
+    REQUIRE(module != nullptr);
+
+    auto function = module->getFunction("SelectCycle");
+    REQUIRE(function != nullptr);
+
+    auto values = GetInstructionValues(*function);
+    REQUIRE(values.size() == 5U);
+
+    // Every value can reach the stack pointer through `%2`, even when `%2`
+    // is asked about while the rest of the cycle is still being evaluated.
+    CheckAnswersInAnyOrder(module->getDataLayout(), values,
+                           {true, true, true, true, true});
+
+    // Asking about `%2` first evaluates `%3` before `%2` has an answer. That
+    // answer for `%3` must not stick.
+    StackPointerResolver sp_resolver(module->getDataLayout());
+    CHECK(sp_resolver.IsRelatedToStackPointer(values[1]));
+    CHECK(sp_resolver.IsRelatedToStackPointer(values[2]));
+    CHECK(sp_resolver.IsRelatedToStackPointer(values[0]));
+  }
+}
+
+}  // namespace anvill
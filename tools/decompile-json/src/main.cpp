@@ -18,20 +18,35 @@
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
+#include <algorithm>
 #include <cstdint>
 #include <ios>
 #include <iostream>
 #include <memory>
 #include <sstream>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 #include <magic_enum.hpp>
 #include "anvill/Version.h"
 
 // clang-format off
 #include <remill/BC/Compat/CTypes.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/IR/GlobalVariable.h>
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/Module.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/FormatVariadic.h>
 #include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Transforms/Utils/Cloning.h>
+#include <llvm/Transforms/Utils/ValueMapper.h>
 
 // clang-format on
 
@@ -44,9 +59,12 @@
 #include <remill/OS/OS.h>
 
 #include <anvill/ABI.h>
+#include <anvill/ExternalData.h>
 #include <anvill/Lifters/EntityLifter.h>
 #include <anvill/Providers/MemoryProvider.h>
 #include <anvill/Providers/TypeProvider.h>
+#include <anvill/Shards.h>
+#include <anvill/Statistics.h>
 
 #include "anvill/Decl.h"
 #include "anvill/Optimize.h"
@@ -62,6 +80,76 @@ DEFINE_string(ir_out, "", "Path to file where the LLVM IR should be saved.");
 DEFINE_string(bc_out, "",
               "Path to file where the LLVM bitcode should be "
               "saved.");
+DEFINE_string(stats_out, "",
+              "Path to file where a JSON report of per-function lifting and "
+              "per-pass optimization timings and IR sizes should be saved.");
+DEFINE_string(roots, "",
+              "Comma-separated list of addresses (e.g. 0x401000) of functions "
+              "or variables from which to start lifting. If specified, only "
+              "the entities reachable from these roots are lifted; all other "
+              "entities are at most declared. By default, every function and "
+              "variable in the spec is lifted.");
+DEFINE_string(shard, "",
+              "Deterministically select a subset of the functions in the spec "
+              "to lift, in the form 'i/N', e.g. '0/4' for the first of four "
+              "shards. Functions are divided into N contiguous runs in "
+              "address order; functions outside of the run of shard i are "
+              "only declared. Use anvill-link-shards to merge the results.");
+DEFINE_string(addresses, "",
+              "Comma-separated list of function addresses (e.g. 0x401000) "
+              "and address ranges (e.g. 0x401000-0x402000, excluding the end "
+              "address) that select which functions in the spec to lift. "
+              "Other functions are only declared. Can be combined with "
+              "--shard.");
+DEFINE_uint32(max_decoded_instructions, 0,
+              "Maximum number of instructions to decode per function. Zero "
+              "means unlimited.");
+DEFINE_uint32(max_basic_blocks, 0,
+              "Maximum number of basic blocks to lift per function. Zero "
+              "means unlimited.");
+DEFINE_uint32(max_ir_instructions, 0,
+              "Maximum number of LLVM instructions per lifted function. Zero "
+              "means unlimited.");
+DEFINE_uint32(predecode_threads, 0,
+              "Number of threads with which to decode all instructions "
+              "reachable from the functions in the spec, ahead of lifting. "
+              "Zero disables pre-decoding.");
+DEFINE_uint32(optimization_threads, 1,
+              "Number of threads with which to run the per-function "
+              "optimization passes.");
+DEFINE_string(optimization_profile, "balanced",
+              "How much effort to put into optimizing the lifted code. One of "
+              "'fast', 'balanced', or 'thorough'.");
+DEFINE_bool(capture_function_snapshots, false,
+            "Capture the IR of each function before every anvill pass, so "
+            "that fatal optimization errors can report the IR from before "
+            "the failing pass. This is slow, and meant for debugging.");
+DEFINE_bool(declare_over_budget, false,
+            "Leave functions that exceed a lifting budget as declarations, "
+            "instead of cutting them off with calls to __remill_error.");
+DEFINE_string(external_data_out, "",
+              "Path to a file where the contents of variables that are at "
+              "least --external_data_threshold bytes in size should be saved, "
+              "instead of being lifted into the module. A manifest of where "
+              "each variable is in the file is saved to the same path, with "
+              "'.manifest.json' appended.");
+DEFINE_uint64(external_data_threshold, 1u << 20u,
+              "Minimum size, in bytes, of variables whose contents are saved "
+              "to --external_data_out.");
+DEFINE_string(shard_out_dir, "",
+              "Path to a directory where the lifted module should be saved as "
+              "a series of self-contained bitcode shards, along with an "
+              "'index.json' file that maps addresses to shards. Functions are "
+              "lifted, optimized, and saved one shard at a time, so that only "
+              "one shard's worth of function bodies is in memory at once. "
+              "Functions are not inlined across shards. Cannot be combined "
+              "with --roots, --ir_out, or --bc_out.");
+DEFINE_uint32(functions_per_shard, 1000,
+              "Maximum number of lifted function definitions in each shard "
+              "saved to --shard_out_dir.");
+DEFINE_bool(lazy_data_initializers, false,
+            "Only read and lift the initializers of variables that are still "
+            "referenced after optimization.");
 
 static void SetVersion(void) {
   std::stringstream ss;
@@ -676,6 +764,281 @@ static bool ParseSpec(const remill::Arch *arch, llvm::LLVMContext &context,
   return true;
 }
 
+// Parse the comma-separated list of addresses in `--roots`.
+static bool ParseRoots(std::vector<uint64_t> &roots) {
+  llvm::SmallVector<llvm::StringRef, 16> parts;
+  llvm::StringRef(FLAGS_roots).split(parts, ',', -1, false);
+  for (auto part : parts) {
+    uint64_t address = 0;
+    if (part.trim().getAsInteger(0, address)) {
+      LOG(ERROR) << "Invalid address '" << part.str() << "' in --roots";
+      return false;
+    }
+    roots.push_back(address);
+  }
+  return true;
+}
+
+// Parse `--shard` and `--addresses` into `selector`.
+static bool ParseFunctionSelector(anvill::FunctionSelector &selector) {
+  if (!FLAGS_shard.empty()) {
+    auto [index_str, count_str] = llvm::StringRef(FLAGS_shard).split('/');
+    if (index_str.trim().getAsInteger(10, selector.shard_index) ||
+        count_str.trim().getAsInteger(10, selector.num_shards) ||
+        !selector.num_shards || selector.shard_index >= selector.num_shards) {
+      LOG(ERROR) << "Invalid shard '" << FLAGS_shard
+                 << "' in --shard; expected 'i/N', where i < N";
+      return false;
+    }
+  }
+
+  llvm::SmallVector<llvm::StringRef, 16> parts;
+  llvm::StringRef(FLAGS_addresses).split(parts, ',', -1, false);
+  for (auto part : parts) {
+    auto [begin_str, end_str] = part.split('-');
+    uint64_t begin = 0;
+    uint64_t end = 0;
+    if (begin_str.trim().getAsInteger(0, begin)) {
+      LOG(ERROR) << "Invalid address '" << part.str() << "' in --addresses";
+      return false;
+    }
+
+    // A single address.
+    if (end_str.empty()) {
+      end = begin + 1u;
+
+    } else if (end_str.trim().getAsInteger(0, end) || end <= begin) {
+      LOG(ERROR) << "Invalid address range '" << part.str()
+                 << "' in --addresses";
+      return false;
+    }
+    selector.ranges.emplace_back(begin, end);
+  }
+
+  return true;
+}
+
+// Parse the name of the optimization profile in `--optimization_profile`.
+static bool ParseOptimizationProfile(anvill::OptimizationProfile &profile) {
+  if (FLAGS_optimization_profile == "fast") {
+    profile = anvill::OptimizationProfile::kFast;
+  } else if (FLAGS_optimization_profile == "balanced") {
+    profile = anvill::OptimizationProfile::kBalanced;
+  } else if (FLAGS_optimization_profile == "thorough") {
+    profile = anvill::OptimizationProfile::kThorough;
+  } else {
+    LOG(ERROR) << "Invalid optimization profile '"
+               << FLAGS_optimization_profile
+               << "' in --optimization_profile; expected one of 'fast', "
+               << "'balanced', or 'thorough'";
+    return false;
+  }
+  return true;
+}
+
+// Apply the symbol names in the spec to the lifted functions and variables.
+static void ApplySymbolNames(const anvill::Program &program,
+                             const anvill::EntityLifter &lifter) {
+  program.ForEachNamedAddress([&](uint64_t addr, const std::string &name,
+                                  const anvill::FunctionDecl *fdecl,
+                                  const anvill::GlobalVarDecl *vdecl) {
+    if (vdecl) {
+      if (auto var = lifter.DeclareEntity(*vdecl)) {
+        var->setName(name);
+      }
+    } else if (fdecl) {
+      if (auto func = lifter.DeclareEntity(*fdecl)) {
+        func->setName(name);
+      }
+    }
+    return true;
+  });
+}
+
+// Give the symbolic variables that are only declared in `module`, e.g.
+// `__anvill_pc`, null initializers and internal linkage.
+static void InitializeSymbolicVariables(llvm::Module &module) {
+  for (auto &var : module.globals()) {
+    if (var.isDeclaration() &&
+        var.getName().startswith(anvill::kAnvillNamePrefix)) {
+      var.setInitializer(llvm::Constant::getNullValue(var.getValueType()));
+      var.setLinkage(llvm::GlobalValue::InternalLinkage);
+    }
+  }
+}
+
+// Lift, optimize, and save the functions selected by `selector` as a series
+// of self-contained bitcode shards in `dir`. Functions are lifted and
+// optimized `functions_per_shard` at a time, in address order. Once a shard
+// is saved, the bodies of its functions are deleted from `module`, so that
+// only one shard's worth of function bodies is alive at any time. Each shard
+// declares whatever it references from other shards. An `index.json` file in
+// `dir` maps the addresses of lifted entities to the shards that define them.
+//
+// Every other definition, e.g. of a variable, alias, or helper function, is
+// saved to the first shard that is saved after it is defined. Definitions
+// with local linkage are given external linkage in the shards, so that all
+// shards refer to the one definition. The exceptions are the symbolic
+// variables, e.g. `__anvill_pc`, which only exist to be referenced, and which
+// `anvill-link-shards` unifies. Appending variables, e.g.
+// `llvm.compiler.used`, are defined in every shard, as they can't be declared.
+//
+// NOTE(pag): Functions in one shard can't be inlined into functions in
+//            another shard.
+static bool LiftModuleShards(const remill::Arch *arch,
+                             const anvill::Program &program,
+                             const anvill::EntityLifter &lifter,
+                             llvm::Module &module,
+                             const anvill::LifterOptions &options,
+                             const anvill::FunctionSelector &selector,
+                             const std::string &dir,
+                             unsigned functions_per_shard) {
+  if (auto ec = llvm::sys::fs::create_directories(dir)) {
+    LOG(ERROR) << "Could not create shard directory " << dir << ": "
+               << ec.message();
+    return false;
+  }
+
+  std::vector<const anvill::FunctionDecl *> decls;
+  program.ForEachFunction([&](const anvill::FunctionDecl *decl) {
+    if (selector.Selects(decl->address)) {
+      decls.push_back(decl);
+    } else {
+      (void) lifter.DeclareEntity(*decl);
+    }
+    return true;
+  });
+  std::stable_sort(decls.begin(), decls.end(),
+                   [](const anvill::FunctionDecl *a,
+                      const anvill::FunctionDecl *b) {
+                     return a->address < b->address;
+                   });
+
+  const auto per_shard = std::max(functions_per_shard, 1u);
+  const auto num_shards = std::max<size_t>(
+      (decls.size() + per_shard - 1u) / per_shard, 1u);
+
+  auto entity_json = [&](llvm::GlobalValue *gv) {
+    llvm::json::Object entity{{"name", gv->getName().str()}};
+    if (auto maybe_address = lifter.AddressOfEntity(gv)) {
+      entity["address"] = static_cast<int64_t>(*maybe_address);
+    }
+    return entity;
+  };
+
+  // Symbolic variables with local linkage are copied into every shard.
+  const auto is_symbolic = [](const llvm::GlobalValue *gv) {
+    return gv->hasLocalLinkage() &&
+           gv->getName().startswith(anvill::kAnvillNamePrefix);
+  };
+
+  // Names of the definitions that have already been saved to a shard. Names
+  // are used rather than pointers, as later optimizations may delete saved
+  // definitions.
+  std::unordered_set<std::string> saved;
+
+  llvm::json::Array shards;
+  for (size_t shard = 0u; shard < num_shards; ++shard) {
+    std::vector<llvm::Function *> funcs;
+    for (auto i = shard * per_shard;
+         i < std::min<size_t>((shard + 1u) * per_shard, decls.size()); ++i) {
+      if (auto func = lifter.LiftEntity(*(decls[i]));
+          func && !func->isDeclaration()) {
+        funcs.push_back(func);
+      }
+    }
+
+    if (!remill::VerifyModule(&module)) {
+      LOG(ERROR) << "Couldn't verify module of shard " << shard;
+      return false;
+    }
+
+    anvill::OptimizeModule(lifter, arch, program, module, options);
+    ApplySymbolNames(program, lifter);
+    lifter.MaterializeCompilerUsed();
+
+    // Definitions with local linkage become external, and so they need names
+    // by which other shards can refer to them.
+    for (auto &gv : module.global_values()) {
+      if (!gv.hasName() && gv.hasLocalLinkage() && !gv.isDeclaration()) {
+        gv.setName("shard_local");
+      }
+    }
+
+    std::vector<llvm::GlobalValue *> defined;
+    for (auto &gv : module.global_values()) {
+      if (!gv.isDeclaration() && !gv.hasAppendingLinkage() &&
+          !is_symbolic(&gv) && !saved.count(gv.getName().str())) {
+        defined.push_back(&gv);
+      }
+    }
+
+    const auto should_define = [&](const llvm::GlobalValue *gv) {
+      return gv->hasAppendingLinkage() || is_symbolic(gv) ||
+             !saved.count(gv->getName().str());
+    };
+
+    llvm::ValueToValueMapTy value_map;
+    auto shard_module = llvm::CloneModule(module, value_map, should_define);
+    for (auto gv : defined) {
+      if (gv->hasLocalLinkage()) {
+        auto gv_copy = llvm::cast<llvm::GlobalValue>(
+            static_cast<llvm::Value *>(value_map[gv]));
+        gv_copy->setLinkage(llvm::GlobalValue::ExternalLinkage);
+      }
+    }
+    InitializeSymbolicVariables(*shard_module);
+
+    const auto file_name = llvm::formatv("shard_{0}.bc", shard).str();
+    llvm::SmallString<256> path(dir);
+    llvm::sys::path::append(path, file_name);
+    if (!remill::StoreModuleToFile(shard_module.get(), path.str().str(),
+                                   true)) {
+      LOG(ERROR) << "Could not save shard to " << path.str().str();
+      return false;
+    }
+    shard_module.reset();
+
+    llvm::json::Array shard_funcs;
+    llvm::json::Array shard_vars;
+    for (auto func : funcs) {
+      shard_funcs.push_back(entity_json(func));
+    }
+    for (auto gv : defined) {
+      saved.insert(gv->getName().str());
+      if (!llvm::isa<llvm::Function>(gv)) {
+        shard_vars.push_back(entity_json(gv));
+      }
+    }
+
+    // Free the bodies of this shard's functions before lifting the next
+    // shard.
+    for (auto func : funcs) {
+      func->deleteBody();
+    }
+
+    shards.push_back(llvm::json::Object{{"path", file_name},
+                                        {"functions", std::move(shard_funcs)},
+                                        {"variables", std::move(shard_vars)}});
+  }
+
+  llvm::SmallString<256> index_path(dir);
+  llvm::sys::path::append(index_path, "index.json");
+  std::error_code ec;
+  llvm::raw_fd_ostream index_os(index_path, ec, llvm::sys::fs::OF_Text);
+  if (ec) {
+    LOG(ERROR) << "Could not save shard index to " << index_path.str().str()
+               << ": " << ec.message();
+    return false;
+  }
+
+  llvm::json::Value doc(llvm::json::Object{
+      {"module", module.getModuleIdentifier()},
+      {"shards", std::move(shards)}});
+  index_os << llvm::formatv("{0:2}", doc) << '\n';
+  return true;
+}
+
 }  // namespace
 
 int main(int argc, char *argv[]) {
@@ -764,6 +1127,45 @@ int main(int argc, char *argv[]) {
   anvill::LifterOptions
       options(arch.get(), module,ctrl_flow_provider_res.TakeValue());
 
+  options.max_decoded_instructions = FLAGS_max_decoded_instructions;
+  options.max_basic_blocks = FLAGS_max_basic_blocks;
+  options.max_ir_instructions = FLAGS_max_ir_instructions;
+  options.num_optimization_threads = FLAGS_optimization_threads;
+  if (!ParseOptimizationProfile(options.optimization_profile)) {
+    return EXIT_FAILURE;
+  }
+
+  options.capture_function_snapshots = FLAGS_capture_function_snapshots;
+  options.lazy_data_initializers = FLAGS_lazy_data_initializers;
+
+  anvill::Statistics stats;
+  if (!FLAGS_stats_out.empty()) {
+    options.statistics = &stats;
+  }
+
+  // The contents of large variables are streamed to the external data file
+  // as they're lifted.
+  std::unique_ptr<llvm::raw_fd_ostream> external_data_os;
+  std::unique_ptr<anvill::ExternalData> external_data;
+  if (!FLAGS_external_data_out.empty()) {
+    std::error_code ec;
+    external_data_os = std::make_unique<llvm::raw_fd_ostream>(
+        FLAGS_external_data_out, ec, llvm::sys::fs::OF_None);
+    if (ec) {
+      std::cerr << "Could not open external data file "
+                << FLAGS_external_data_out << ": " << ec.message() << '\n';
+      return EXIT_FAILURE;
+    }
+    external_data = std::make_unique<anvill::ExternalData>(*external_data_os);
+    options.external_data = external_data.get();
+    options.external_data_threshold = FLAGS_external_data_threshold;
+  }
+
+  if (FLAGS_declare_over_budget) {
+    options.lifting_budget_exceeded_action =
+        anvill::LiftingBudgetExceededAction::kDeclareOnly;
+  }
+
   // NOTE(pag): Unfortunately, we need to load the semantics module first,
   //            which happens deep inside the `EntityLifter`. Only then does
   //            Remill properly know about register information, which
@@ -777,74 +1179,168 @@ int main(int argc, char *argv[]) {
     return EXIT_FAILURE;
   }
 
-  program.ForEachVariable([&](const anvill::GlobalVarDecl *decl) {
-    (void) lifter.LiftEntity(*decl);
-    return true;
-  });
+  // Decode instructions in parallel ahead of time, so that the function
+  // lifter doesn't need to.
+  if (FLAGS_predecode_threads) {
+    std::vector<uint64_t> func_addresses;
+    program.ForEachFunction([&](const anvill::FunctionDecl *decl) {
+      func_addresses.push_back(decl->address);
+      return true;
+    });
+    options.decode_table = anvill::DecodeTable::Create(
+        arch.get(), *memory, func_addresses, FLAGS_predecode_threads);
+  }
 
-  // Lift functions.
-  program.ForEachFunction([&](const anvill::FunctionDecl *decl) {
-    (void) lifter.LiftEntity(*decl);
-    return true;
-  });
+  std::vector<uint64_t> roots;
+  if (!ParseRoots(roots)) {
+    return EXIT_FAILURE;
+  }
 
-  // Verify the module
-  if (!remill::VerifyModule(&module)) {
-    std::string json_outs;
-    if (llvm::json::fromJSON(json, json_outs)) {
-      std::cerr << "Couldn't verify module produced from spec:\n"
-                << json_outs << '\n';
+  anvill::FunctionSelector selector;
+  if (!ParseFunctionSelector(selector)) {
+    return EXIT_FAILURE;
+  }
 
-    } else {
-      std::cerr << "Couldn't verify module produced from spec:\n"
-                << buff->getBuffer().str() << '\n';
+  if (selector.IsEnabled()) {
+    if (!roots.empty()) {
+      LOG(ERROR) << "--roots cannot be combined with --shard or --addresses";
+      return EXIT_FAILURE;
     }
+
+    program.ForEachFunction([&](const anvill::FunctionDecl *decl) {
+      selector.func_addresses.push_back(decl->address);
+      return true;
+    });
+    std::sort(selector.func_addresses.begin(), selector.func_addresses.end());
+    selector.func_addresses.erase(
+        std::unique(selector.func_addresses.begin(),
+                    selector.func_addresses.end()),
+        selector.func_addresses.end());
+  }
+
+  // When saving shards, the functions are lifted, optimized, and saved one
+  // shard at a time, so there is never a whole module to save or to search
+  // for reachable entities.
+  const auto is_sharded = !FLAGS_shard_out_dir.empty();
+  if (is_sharded &&
+      (!roots.empty() || !FLAGS_ir_out.empty() || !FLAGS_bc_out.empty())) {
+    LOG(ERROR) << "--shard_out_dir cannot be combined with --roots, "
+               << "--ir_out, or --bc_out";
     return EXIT_FAILURE;
   }
 
-  // OLD: Apply optimizations.
-  anvill::OptimizeModule(lifter, arch.get(), program, module, options);
+  // Only lift what is reachable from the roots.
+  if (!roots.empty()) {
+    const auto num_lifted = lifter.LiftReachableEntities(roots);
+    LOG(INFO) << "Lifted " << num_lifted << " entities reachable from "
+              << roots.size() << " roots";
 
-  // Apply symbol names to functions if we have the names.
-  program.ForEachNamedAddress([&](uint64_t addr, const std::string &name,
-                                  const anvill::FunctionDecl *fdecl,
-                                  const anvill::GlobalVarDecl *vdecl) {
-    if (vdecl) {
-      if (auto var = lifter.DeclareEntity(*vdecl)) {
-        var->setName(name);
-      }
-    } else if (fdecl) {
-      if (auto func = lifter.DeclareEntity(*fdecl)) {
-        func->setName(name);
+  // Lift everything.
+  } else {
+
+    // When sharding, variables are lifted into every shard, and
+    // `anvill-link-shards` keeps only one definition of each.
+    program.ForEachVariable([&](const anvill::GlobalVarDecl *decl) {
+      (void) lifter.LiftEntity(*decl);
+      return true;
+    });
+
+    // Lift functions, or only declare those that aren't selected. With
+    // `--shard_out_dir`, this happens one shard at a time, below.
+    if (!is_sharded) {
+      program.ForEachFunction([&](const anvill::FunctionDecl *decl) {
+        if (selector.Selects(decl->address)) {
+          (void) lifter.LiftEntity(*decl);
+        } else {
+          (void) lifter.DeclareEntity(*decl);
+        }
+        return true;
+      });
+    }
+  }
+
+  int ret = EXIT_SUCCESS;
+
+  if (is_sharded) {
+    if (!LiftModuleShards(arch.get(), program, lifter, module, options,
+                          selector, FLAGS_shard_out_dir,
+                          FLAGS_functions_per_shard)) {
+      ret = EXIT_FAILURE;
+    }
+
+  } else {
+
+    // Verify the module
+    if (!remill::VerifyModule(&module)) {
+      std::string json_outs;
+      if (llvm::json::fromJSON(json, json_outs)) {
+        std::cerr << "Couldn't verify module produced from spec:\n"
+                  << json_outs << '\n';
+
+      } else {
+        std::cerr << "Couldn't verify module produced from spec:\n"
+                  << buff->getBuffer().str() << '\n';
       }
+      return EXIT_FAILURE;
     }
-    return true;
-  });
 
-  // Clean up by initializing variables.
-  for (auto &var : module.globals()) {
-    if (!var.isDeclaration()) {
-      continue;
+    // OLD: Apply optimizations.
+    anvill::OptimizeModule(lifter, arch.get(), program, module, options);
+
+    // Apply symbol names to functions if we have the names.
+    ApplySymbolNames(program, lifter);
+
+    // Naming may have declared new entities.
+    lifter.MaterializeCompilerUsed();
+
+    // Clean up by initializing variables.
+    InitializeSymbolicVariables(module);
+
+    if (!FLAGS_ir_out.empty()) {
+      if (!remill::StoreModuleIRToFile(&module, FLAGS_ir_out, true)) {
+        std::cerr << "Could not save LLVM IR to " << FLAGS_ir_out << '\n';
+        ret = EXIT_FAILURE;
+      }
     }
-    const auto name = var.getName();
-    if (name.startswith(anvill::kAnvillNamePrefix)) {
-      var.setInitializer(llvm::Constant::getNullValue(var.getValueType()));
-      var.setLinkage(llvm::GlobalValue::InternalLinkage);
+    if (!FLAGS_bc_out.empty()) {
+      if (!remill::StoreModuleToFile(&module, FLAGS_bc_out, true)) {
+        std::cerr << "Could not save LLVM bitcode to " << FLAGS_bc_out
+                  << '\n';
+        ret = EXIT_FAILURE;
+      }
     }
   }
 
-  int ret = EXIT_SUCCESS;
+  if (external_data) {
+    external_data_os->close();
+    if (external_data_os->has_error()) {
+      std::cerr << "Could not save external data to "
+                << FLAGS_external_data_out << '\n';
+      external_data_os->clear_error();
+      ret = EXIT_FAILURE;
+    }
 
-  if (!FLAGS_ir_out.empty()) {
-    if (!remill::StoreModuleIRToFile(&module, FLAGS_ir_out, true)) {
-      std::cerr << "Could not save LLVM IR to " << FLAGS_ir_out << '\n';
+    const auto manifest_path = FLAGS_external_data_out + ".manifest.json";
+    std::error_code ec;
+    llvm::raw_fd_ostream manifest_os(manifest_path, ec,
+                                     llvm::sys::fs::OF_Text);
+    if (ec) {
+      std::cerr << "Could not save external data manifest to "
+                << manifest_path << ": " << ec.message() << '\n';
       ret = EXIT_FAILURE;
+    } else {
+      external_data->PrintManifestJSON(manifest_os);
     }
   }
-  if (!FLAGS_bc_out.empty()) {
-    if (!remill::StoreModuleToFile(&module, FLAGS_bc_out, true)) {
-      std::cerr << "Could not save LLVM bitcode to " << FLAGS_bc_out << '\n';
+  if (!FLAGS_stats_out.empty()) {
+    std::error_code ec;
+    llvm::raw_fd_ostream stats_os(FLAGS_stats_out, ec, llvm::sys::fs::OF_Text);
+    if (ec) {
+      std::cerr << "Could not save statistics to " << FLAGS_stats_out << ": "
+                << ec.message() << '\n';
       ret = EXIT_FAILURE;
+    } else {
+      stats.PrintJSON(stats_os);
     }
   }
 
@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2021 Trail of Bits, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <anvill/Shards.h>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <remill/BC/Compat/Error.h>
+#include <remill/BC/Util.h>
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if __has_include(<llvm/Support/JSON.h>)
+#  include <llvm/Support/JSON.h>
+
+DEFINE_string(index, "",
+              "Path to an 'index.json' file, as saved by anvill-decompile-json "
+              "with --shard_out_dir, that lists the shards to merge.");
+DEFINE_string(shards, "",
+              "Comma-separated list of paths to shard bitcode files to merge, "
+              "e.g. the --bc_out files of several anvill-decompile-json runs "
+              "with different --shard selections.");
+DEFINE_string(ir_out, "", "Path to file where the merged LLVM IR should be "
+                          "saved.");
+DEFINE_string(bc_out, "",
+              "Path to file where the merged LLVM bitcode should be saved.");
+
+namespace {
+
+// Collect the paths of the shards listed in `--index` and in `--shards`.
+static bool ParseShardPaths(std::vector<std::string> &paths) {
+  if (!FLAGS_index.empty()) {
+    auto maybe_buff = llvm::MemoryBuffer::getFile(FLAGS_index);
+    if (remill::IsError(maybe_buff)) {
+      LOG(ERROR) << "Unable to read shard index file '" << FLAGS_index
+                 << "': " << remill::GetErrorString(maybe_buff);
+      return false;
+    }
+
+    const auto &buff = remill::GetReference(maybe_buff);
+    auto maybe_json = llvm::json::parse(buff->getBuffer());
+    if (remill::IsError(maybe_json)) {
+      LOG(ERROR) << "Unable to parse shard index file '" << FLAGS_index
+                 << "': " << remill::GetErrorString(maybe_json);
+      return false;
+    }
+
+    const auto &json = remill::GetReference(maybe_json);
+    const auto index = json.getAsObject();
+    const auto shards = index ? index->getArray("shards") : nullptr;
+    if (!shards) {
+      LOG(ERROR) << "Missing 'shards' array in shard index file '"
+                 << FLAGS_index << "'";
+      return false;
+    }
+
+    // Shard paths are relative to the index file.
+    const auto dir = llvm::sys::path::parent_path(FLAGS_index);
+    for (const auto &shard : *shards) {
+      const auto shard_obj = shard.getAsObject();
+      const auto maybe_path =
+          shard_obj ? shard_obj->getString("path") : llvm::None;
+      if (!maybe_path) {
+        LOG(ERROR) << "Missing 'path' of shard in shard index file '"
+                   << FLAGS_index << "'";
+        return false;
+      }
+
+      llvm::SmallString<256> path(dir);
+      llvm::sys::path::append(path, *maybe_path);
+      paths.push_back(path.str().str());
+    }
+  }
+
+  llvm::SmallVector<llvm::StringRef, 16> parts;
+  llvm::StringRef(FLAGS_shards).split(parts, ',', -1, false);
+  for (auto part : parts) {
+    paths.push_back(part.trim().str());
+  }
+
+  if (paths.empty()) {
+    LOG(ERROR) << "Please specify the shards to merge with --index or --shards";
+    return false;
+  }
+
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+
+  std::vector<std::string> paths;
+  if (!ParseShardPaths(paths)) {
+    return EXIT_FAILURE;
+  }
+
+  llvm::LLVMContext context;
+  std::unique_ptr<llvm::Module> dest(
+      remill::LoadModuleFromFile(&context, paths[0], true));
+  if (!dest) {
+    LOG(ERROR) << "Unable to load shard '" << paths[0] << "'";
+    return EXIT_FAILURE;
+  }
+
+  anvill::ShardLinker linker(*dest);
+  for (auto i = 1u; i < paths.size(); ++i) {
+    std::unique_ptr<llvm::Module> src(
+        remill::LoadModuleFromFile(&context, paths[i], true));
+    if (!src) {
+      LOG(ERROR) << "Unable to load shard '" << paths[i] << "'";
+      return EXIT_FAILURE;
+    }
+
+    if (auto err = linker.Link(std::move(src))) {
+      LOG(ERROR) << "Unable to link shard '" << paths[i]
+                 << "': " << llvm::toString(std::move(err));
+      return EXIT_FAILURE;
+    }
+  }
+  linker.Finish();
+
+  if (!remill::VerifyModule(dest.get())) {
+    LOG(ERROR) << "Merged module is not valid";
+    return EXIT_FAILURE;
+  }
+
+  LOG(INFO) << "Merged " << paths.size() << " shards";
+
+  int ret = EXIT_SUCCESS;
+
+  if (!FLAGS_ir_out.empty()) {
+    if (!remill::StoreModuleIRToFile(dest.get(), FLAGS_ir_out, true)) {
+      std::cerr << "Could not save LLVM IR to " << FLAGS_ir_out << '\n';
+      ret = EXIT_FAILURE;
+    }
+  }
+  if (!FLAGS_bc_out.empty()) {
+    if (!remill::StoreModuleToFile(dest.get(), FLAGS_bc_out, true)) {
+      std::cerr << "Could not save LLVM bitcode to " << FLAGS_bc_out << '\n';
+      ret = EXIT_FAILURE;
+    }
+  }
+
+  return ret;
+}
+
+#else
+int main(int argc, char *argv[]) {
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  std::cerr << "LLVM JSON API is not available in this version of LLVM\n";
+  return EXIT_FAILURE;
+}
+#endif